@@ -222,6 +222,10 @@ static const GFXglyph FreeMono12pt7bGlyphs[]  = {
 const GFXfont FreeMono12pt7b  = {
   (uint8_t  *)FreeMono12pt7bBitmaps,
   (GFXglyph *)FreeMono12pt7bGlyphs,
-  0x20, 0x7E, 24 };
+  0x20, 0x7E, 24,
+  NULL, 0, 0,
+  NULL, 0,
+  NULL,
+  NULL };
 
 // Approx. 2132 bytes
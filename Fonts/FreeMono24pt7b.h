@@ -572,6 +572,10 @@ static const GFXglyph FreeMono24pt7bGlyphs[]  = {
 const GFXfont FreeMono24pt7b  = {
   (uint8_t  *)FreeMono24pt7bBitmaps,
   (GFXglyph *)FreeMono24pt7bGlyphs,
-  0x20, 0x7E, 47 };
+  0x20, 0x7E, 47,
+  NULL, 0, 0,
+  NULL, 0,
+  NULL,
+  NULL };
 
 // Approx. 6330 bytes
@@ -171,6 +171,10 @@ static const GFXglyph FreeMono9pt7bGlyphs[]  = {
 const GFXfont FreeMono9pt7b  = {
   (uint8_t  *)FreeMono9pt7bBitmaps,
   (GFXglyph *)FreeMono9pt7bGlyphs,
-  0x20, 0x7E, 18 };
+  0x20, 0x7E, 18,
+  NULL, 0, 0,
+  NULL, 0,
+  NULL,
+  NULL };
 
 // Approx. 1516 bytes
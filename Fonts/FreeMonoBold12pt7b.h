@@ -245,6 +245,10 @@ static const GFXglyph FreeMonoBold12pt7bGlyphs[]  = {
 const GFXfont FreeMonoBold12pt7b  = {
   (uint8_t  *)FreeMonoBold12pt7bBitmaps,
   (GFXglyph *)FreeMonoBold12pt7bGlyphs,
-  0x20, 0x7E, 24 };
+  0x20, 0x7E, 24,
+  NULL, 0, 0,
+  NULL, 0,
+  NULL,
+  NULL };
 
 // Approx. 2402 bytes
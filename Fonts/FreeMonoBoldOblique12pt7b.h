@@ -264,6 +264,10 @@ static const GFXglyph FreeMonoBoldOblique12pt7bGlyphs[]  = {
 const GFXfont FreeMonoBoldOblique12pt7b  = {
   (uint8_t  *)FreeMonoBoldOblique12pt7bBitmaps,
   (GFXglyph *)FreeMonoBoldOblique12pt7bGlyphs,
-  0x20, 0x7E, 24 };
+  0x20, 0x7E, 24,
+  NULL, 0, 0,
+  NULL, 0,
+  NULL,
+  NULL };
 
 // Approx. 2638 bytes
@@ -455,6 +455,10 @@ static const GFXglyph FreeMonoBoldOblique18pt7bGlyphs[]  = {
 const GFXfont FreeMonoBoldOblique18pt7b  = {
   (uint8_t  *)FreeMonoBoldOblique18pt7bBitmaps,
   (GFXglyph *)FreeMonoBoldOblique18pt7bGlyphs,
-  0x20, 0x7E, 35 };
+  0x20, 0x7E, 35,
+  NULL, 0, 0,
+  NULL, 0,
+  NULL,
+  NULL };
 
 // Approx. 4928 bytes
@@ -737,6 +737,10 @@ static const GFXglyph FreeMonoBoldOblique24pt7bGlyphs[]  = {
 const GFXfont FreeMonoBoldOblique24pt7b  = {
   (uint8_t  *)FreeMonoBoldOblique24pt7bBitmaps,
   (GFXglyph *)FreeMonoBoldOblique24pt7bGlyphs,
-  0x20, 0x7E, 47 };
+  0x20, 0x7E, 47,
+  NULL, 0, 0,
+  NULL, 0,
+  NULL,
+  NULL };
 
 // Approx. 8307 bytes
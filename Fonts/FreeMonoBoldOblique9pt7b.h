@@ -198,6 +198,10 @@ static const GFXglyph FreeMonoBoldOblique9pt7bGlyphs[]  = {
 const GFXfont FreeMonoBoldOblique9pt7b  = {
   (uint8_t  *)FreeMonoBoldOblique9pt7bBitmaps,
   (GFXglyph *)FreeMonoBoldOblique9pt7bGlyphs,
-  0x20, 0x7E, 18 };
+  0x20, 0x7E, 18,
+  NULL, 0, 0,
+  NULL, 0,
+  NULL,
+  NULL };
 
 // Approx. 1839 bytes
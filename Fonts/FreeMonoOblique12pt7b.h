@@ -243,6 +243,10 @@ static const GFXglyph FreeMonoOblique12pt7bGlyphs[]  = {
 const GFXfont FreeMonoOblique12pt7b  = {
   (uint8_t  *)FreeMonoOblique12pt7bBitmaps,
   (GFXglyph *)FreeMonoOblique12pt7bGlyphs,
-  0x20, 0x7E, 24 };
+  0x20, 0x7E, 24,
+  NULL, 0, 0,
+  NULL, 0,
+  NULL,
+  NULL };
 
 // Approx. 2379 bytes
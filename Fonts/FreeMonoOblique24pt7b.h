@@ -638,6 +638,10 @@ static const GFXglyph FreeMonoOblique24pt7bGlyphs[]  = {
 const GFXfont FreeMonoOblique24pt7b  = {
   (uint8_t  *)FreeMonoOblique24pt7bBitmaps,
   (GFXglyph *)FreeMonoOblique24pt7bGlyphs,
-  0x20, 0x7E, 47 };
+  0x20, 0x7E, 47,
+  NULL, 0, 0,
+  NULL, 0,
+  NULL,
+  NULL };
 
 // Approx. 7124 bytes
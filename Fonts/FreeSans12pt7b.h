@@ -265,6 +265,10 @@ static const GFXglyph FreeSans12pt7bGlyphs[]  = {
 const GFXfont FreeSans12pt7b  = {
   (uint8_t  *)FreeSans12pt7bBitmaps,
   (GFXglyph *)FreeSans12pt7bGlyphs,
-  0x20, 0x7E, 29 };
+  0x20, 0x7E, 29,
+  NULL, 0, 0,
+  NULL, 0,
+  NULL,
+  NULL };
 
 // Approx. 2641 bytes
@@ -447,6 +447,10 @@ static const GFXglyph FreeSans18pt7bGlyphs[]  = {
 const GFXfont FreeSans18pt7b  = {
   (uint8_t  *)FreeSans18pt7bBitmaps,
   (GFXglyph *)FreeSans18pt7bGlyphs,
-  0x20, 0x7E, 42 };
+  0x20, 0x7E, 42,
+  NULL, 0, 0,
+  NULL, 0,
+  NULL,
+  NULL };
 
 // Approx. 4831 bytes
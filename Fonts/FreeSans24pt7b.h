@@ -722,6 +722,10 @@ static const GFXglyph FreeSans24pt7bGlyphs[]  = {
 const GFXfont FreeSans24pt7b  = {
   (uint8_t  *)FreeSans24pt7bBitmaps,
   (GFXglyph *)FreeSans24pt7bGlyphs,
-  0x20, 0x7E, 56 };
+  0x20, 0x7E, 56,
+  NULL, 0, 0,
+  NULL, 0,
+  NULL,
+  NULL };
 
 // Approx. 8136 bytes
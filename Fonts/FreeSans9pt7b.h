@@ -196,6 +196,10 @@ static const GFXglyph FreeSans9pt7bGlyphs[]  = {
 const GFXfont FreeSans9pt7b  = {
   (uint8_t  *)FreeSans9pt7bBitmaps,
   (GFXglyph *)FreeSans9pt7bGlyphs,
-  0x20, 0x7E, 22 };
+  0x20, 0x7E, 22,
+  NULL, 0, 0,
+  NULL, 0,
+  NULL,
+  NULL };
 
 // Approx. 1822 bytes
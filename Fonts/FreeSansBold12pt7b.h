@@ -283,6 +283,10 @@ static const GFXglyph FreeSansBold12pt7bGlyphs[]  = {
 const GFXfont FreeSansBold12pt7b  = {
   (uint8_t  *)FreeSansBold12pt7bBitmaps,
   (GFXglyph *)FreeSansBold12pt7bGlyphs,
-  0x20, 0x7E, 29 };
+  0x20, 0x7E, 29,
+  NULL, 0, 0,
+  NULL, 0,
+  NULL,
+  NULL };
 
 // Approx. 2858 bytes
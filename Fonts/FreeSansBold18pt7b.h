@@ -476,6 +476,10 @@ static const GFXglyph FreeSansBold18pt7bGlyphs[]  = {
 const GFXfont FreeSansBold18pt7b  = {
   (uint8_t  *)FreeSansBold18pt7bBitmaps,
   (GFXglyph *)FreeSansBold18pt7bGlyphs,
-  0x20, 0x7E, 42 };
+  0x20, 0x7E, 42,
+  NULL, 0, 0,
+  NULL, 0,
+  NULL,
+  NULL };
 
 // Approx. 5175 bytes
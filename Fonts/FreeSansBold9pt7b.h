@@ -203,6 +203,10 @@ static const GFXglyph FreeSansBold9pt7bGlyphs[]  = {
 const GFXfont FreeSansBold9pt7b  = {
   (uint8_t  *)FreeSansBold9pt7bBitmaps,
   (GFXglyph *)FreeSansBold9pt7bGlyphs,
-  0x20, 0x7E, 22 };
+  0x20, 0x7E, 22,
+  NULL, 0, 0,
+  NULL, 0,
+  NULL,
+  NULL };
 
 // Approx. 1902 bytes
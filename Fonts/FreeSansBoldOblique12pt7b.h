@@ -312,6 +312,10 @@ static const GFXglyph FreeSansBoldOblique12pt7bGlyphs[]  = {
 const GFXfont FreeSansBoldOblique12pt7b  = {
   (uint8_t  *)FreeSansBoldOblique12pt7bBitmaps,
   (GFXglyph *)FreeSansBoldOblique12pt7bGlyphs,
-  0x20, 0x7E, 29 };
+  0x20, 0x7E, 29,
+  NULL, 0, 0,
+  NULL, 0,
+  NULL,
+  NULL };
 
 // Approx. 3207 bytes
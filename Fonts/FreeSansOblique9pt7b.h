@@ -215,6 +215,10 @@ static const GFXglyph FreeSansOblique9pt7bGlyphs[]  = {
 const GFXfont FreeSansOblique9pt7b  = {
   (uint8_t  *)FreeSansOblique9pt7bBitmaps,
   (GFXglyph *)FreeSansOblique9pt7bGlyphs,
-  0x20, 0x7E, 22 };
+  0x20, 0x7E, 22,
+  NULL, 0, 0,
+  NULL, 0,
+  NULL,
+  NULL };
 
 // Approx. 2041 bytes
@@ -254,6 +254,10 @@ static const GFXglyph FreeSerif12pt7bGlyphs[]  = {
 const GFXfont FreeSerif12pt7b  = {
   (uint8_t  *)FreeSerif12pt7bBitmaps,
   (GFXglyph *)FreeSerif12pt7bGlyphs,
-  0x20, 0x7E, 29 };
+  0x20, 0x7E, 29,
+  NULL, 0, 0,
+  NULL, 0,
+  NULL,
+  NULL };
 
 // Approx. 2511 bytes
@@ -424,6 +424,10 @@ static const GFXglyph FreeSerif18pt7bGlyphs[]  = {
 const GFXfont FreeSerif18pt7b  = {
   (uint8_t  *)FreeSerif18pt7bBitmaps,
   (GFXglyph *)FreeSerif18pt7bGlyphs,
-  0x20, 0x7E, 42 };
+  0x20, 0x7E, 42,
+  NULL, 0, 0,
+  NULL, 0,
+  NULL,
+  NULL };
 
 // Approx. 4558 bytes
@@ -685,6 +685,10 @@ static const GFXglyph FreeSerif24pt7bGlyphs[]  = {
 const GFXfont FreeSerif24pt7b  = {
   (uint8_t  *)FreeSerif24pt7bBitmaps,
   (GFXglyph *)FreeSerif24pt7bGlyphs,
-  0x20, 0x7E, 56 };
+  0x20, 0x7E, 56,
+  NULL, 0, 0,
+  NULL, 0,
+  NULL,
+  NULL };
 
 // Approx. 7682 bytes
@@ -190,6 +190,10 @@ static const GFXglyph FreeSerif9pt7bGlyphs[]  = {
 const GFXfont FreeSerif9pt7b  = {
   (uint8_t  *)FreeSerif9pt7bBitmaps,
   (GFXglyph *)FreeSerif9pt7bGlyphs,
-  0x20, 0x7E, 22 };
+  0x20, 0x7E, 22,
+  NULL, 0, 0,
+  NULL, 0,
+  NULL,
+  NULL };
 
 // Approx. 1752 bytes
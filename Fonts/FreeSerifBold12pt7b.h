@@ -266,6 +266,10 @@ static const GFXglyph FreeSerifBold12pt7bGlyphs[]  = {
 const GFXfont FreeSerifBold12pt7b  = {
   (uint8_t  *)FreeSerifBold12pt7bBitmaps,
   (GFXglyph *)FreeSerifBold12pt7bGlyphs,
-  0x20, 0x7E, 29 };
+  0x20, 0x7E, 29,
+  NULL, 0, 0,
+  NULL, 0,
+  NULL,
+  NULL };
 
 // Approx. 2663 bytes
@@ -457,6 +457,10 @@ static const GFXglyph FreeSerifBold18pt7bGlyphs[]  = {
 const GFXfont FreeSerifBold18pt7b  = {
   (uint8_t  *)FreeSerifBold18pt7bBitmaps,
   (GFXglyph *)FreeSerifBold18pt7bGlyphs,
-  0x20, 0x7E, 42 };
+  0x20, 0x7E, 42,
+  NULL, 0, 0,
+  NULL, 0,
+  NULL,
+  NULL };
 
 // Approx. 4945 bytes
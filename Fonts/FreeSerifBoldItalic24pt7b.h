@@ -788,6 +788,10 @@ static const GFXglyph FreeSerifBoldItalic24pt7bGlyphs[]  = {
 const GFXfont FreeSerifBoldItalic24pt7b  = {
   (uint8_t  *)FreeSerifBoldItalic24pt7bBitmaps,
   (GFXglyph *)FreeSerifBoldItalic24pt7bGlyphs,
-  0x20, 0x7E, 56 };
+  0x20, 0x7E, 56,
+  NULL, 0, 0,
+  NULL, 0,
+  NULL,
+  NULL };
 
 // Approx. 8917 bytes
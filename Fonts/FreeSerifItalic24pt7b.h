@@ -732,6 +732,10 @@ static const GFXglyph FreeSerifItalic24pt7bGlyphs[]  = {
 const GFXfont FreeSerifItalic24pt7b  = {
   (uint8_t  *)FreeSerifItalic24pt7bBitmaps,
   (GFXglyph *)FreeSerifItalic24pt7bGlyphs,
-  0x20, 0x7E, 56 };
+  0x20, 0x7E, 56,
+  NULL, 0, 0,
+  NULL, 0,
+  NULL,
+  NULL };
 
 // Approx. 8251 bytes
@@ -125,6 +125,10 @@ static const GFXglyph Tiny3x3a2pt7bGlyphs[]  = {
 const GFXfont Tiny3x3a2pt7b  = {
   (uint8_t  *)Tiny3x3a2pt7bBitmaps,
   (GFXglyph *)Tiny3x3a2pt7bGlyphs,
-  0x20, 0x7E, 4 };
+  0x20, 0x7E, 4,
+  NULL, 0, 0,
+  NULL, 0,
+  NULL,
+  NULL };
 
 // Approx. 814 bytes
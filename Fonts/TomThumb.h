@@ -471,4 +471,8 @@ static const GFXglyph TomThumbGlyphs[]  = {
 const GFXfont TomThumb  = {
   (uint8_t  *)TomThumbBitmaps,
   (GFXglyph *)TomThumbGlyphs,
-  0x20, 0x7E, 6 };
+  0x20, 0x7E, 6,
+  NULL, 0, 0,
+  NULL, 0,
+  NULL,
+  NULL };
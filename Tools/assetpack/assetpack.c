@@ -0,0 +1,346 @@
+/**
+  *@file assetpack.c
+  *@brief Host tool that writes the fonts and images listed in an assets header into a binary asset pack (gfx_asset.h)
+  *
+  *  The assets are compiled into the tool, so any GFXfont (including fontconvert output with ranges, RLE, LZ4 blocks,
+  *  advances or metrics) and GFXBmp header can be packed as is. The pack uses the struct layout of the host, which
+  *  matches little endian targets with 32 bit int
+  *
+  *  usage: assetpack [-l] <out.pak>
+  *
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../../gfx_asset.h"
+
+#ifndef ASSETS
+#define ASSETS "assets.h"
+#endif
+#include ASSETS
+
+/* Private types -------------------------------------------------------------*/
+typedef struct {
+  const char* mName;
+  const GFXfont* mFont;         //NULL for images
+  const GFXBmp* mBmp;           //NULL for fonts
+} asset_t;
+
+typedef struct {
+  uint8_t* mData;
+  uint32_t mSize;
+  uint32_t mCapacity;
+} buffer_t;
+
+/* Private variables ---------------------------------------------------------*/
+#define ASSET_FONT(sym) { #sym, &sym, NULL },
+#define ASSET_BMP(sym) { #sym, NULL, &sym },
+static asset_t sAssets[] = { ASSET_LIST };
+#define ASSET_COUNT ((int)(sizeof(sAssets) / sizeof(sAssets[0])))
+
+/* Private functions ---------------------------------------------------------*/
+
+static void fail(const char* fmt, ...)
+{
+  va_list args;
+  va_start(args, fmt);
+  fprintf(stderr, "assetpack: ");
+  vfprintf(stderr, fmt, args);
+  fprintf(stderr, "\n");
+  va_end(args);
+  exit(1);
+}
+
+static void* xrealloc(void* ptr, size_t size)
+{
+  ptr = realloc(ptr, size ? size : 1);
+  if(ptr == NULL)
+  {
+    fail("out of memory");
+  }
+  return ptr;
+}
+
+static void buffer_append(buffer_t* buf, const void* data, uint32_t len)
+{
+  if(buf->mSize + len > buf->mCapacity)
+  {
+    buf->mCapacity = (buf->mSize + len) * 2;
+    buf->mData = (uint8_t*) xrealloc(buf->mData, buf->mCapacity);
+  }
+  memcpy(&buf->mData[buf->mSize], data, len);
+  buf->mSize += len;
+}
+
+/**
+ * @brief pads a buffer with zeros to a multiple of 4 bytes, and returns the aligned size
+ */
+static uint32_t buffer_align(buffer_t* buf)
+{
+  static const uint8_t zeros[4] = {0};
+  buffer_append(buf, zeros, (4 - (buf->mSize % 4)) % 4);
+  return buf->mSize;
+}
+
+static int compare_assets(const void* a, const void* b)
+{
+  return strcmp(((const asset_t*)a)->mName, ((const asset_t*)b)->mName);
+}
+
+/**
+ * @brief gets the size of a glyph's RLE runs, which cover width*height pixels
+ */
+static uint32_t rle_size(const uint8_t* runs, uint32_t pixels)
+{
+  uint32_t size = 0;
+  uint32_t covered = 0;
+
+  //zero length runs only split long runs, so the last run always ends on the last pixel
+  while(covered < pixels)
+  {
+    covered += runs[size++];
+  }
+  return size;
+}
+
+static int font_glyph_count(const GFXfont* font)
+{
+  int count = 0;
+
+  if(font->mRanges == NULL)
+  {
+    return font->mLast - font->mFirst + 1;
+  }
+
+  for(int i=0; i < font->mRangeCount; i++)
+  {
+    int end = font->mRanges[i].mGlyph + font->mRanges[i].mCount;
+    count = (end > count) ? end : count;
+  }
+  return count;
+}
+
+/**
+ * @brief gets the size of a font's glyph data, which the GFXfont does not store
+ */
+static uint32_t font_bitmap_size(const GFXfont* font, int glyphCount)
+{
+  uint32_t size = 0;
+
+  if(font->mFlags & GFX_FONT_LZ)
+  {
+    return font->mBlocks[font->mBlockCount].mOffset;
+  }
+
+  for(int i=0; i < glyphCount; i++)
+  {
+    uint32_t offset;
+    uint32_t pixels;
+    uint32_t end;
+
+    if(font->mFlags & GFX_FONT_PACKED)
+    {
+      const GFXpackedGlyph* glyph = &((const GFXpackedGlyph*)font->mGlyph)[i];
+      offset = glyph->mOffset;
+      pixels = glyph->mWidth * glyph->mHeight;
+    }
+    else
+    {
+      offset = font->mGlyph[i].mOffset;
+      pixels = font->mGlyph[i].mWidth * font->mGlyph[i].mHeight;
+    }
+
+    if(pixels == 0)
+    {
+      continue;
+    }
+
+    end = offset + ((font->mFlags & GFX_FONT_RLE) ? rle_size(&font->mBitmap[offset], pixels) : ((pixels + 7) / 8));
+    size = (end > size) ? end : size;
+  }
+  return size;
+}
+
+/**
+ * @brief appends a font: a gfx_asset_font_t followed by its arrays
+ */
+static void pack_font(buffer_t* out, const GFXfont* font)
+{
+  gfx_asset_font_t info = {0};
+  uint32_t start = out->mSize;
+  int glyphCount = font_glyph_count(font);
+  uint32_t glyphSize = (font->mFlags & GFX_FONT_PACKED) ? sizeof(GFXpackedGlyph) : sizeof(GFXglyph);
+
+  if((glyphCount <= 0) || (glyphCount > UINT16_MAX))
+  {
+    fail("font has %d glyphs", glyphCount);
+  }
+
+  info.mGlyphCount = glyphCount;
+  info.mRangeCount = font->mRangeCount;
+  info.mBlockCount = font->mBlockCount;
+  info.mFirst = font->mFirst;
+  info.mLast = font->mLast;
+  info.mYAdvance = font->mYAdvance;
+  info.mFlags = font->mFlags;
+  buffer_append(out, &info, sizeof(info));
+
+  //4 byte aligned arrays first, then the byte arrays
+  info.mGlyph = buffer_align(out) - start;
+  buffer_append(out, font->mGlyph, glyphCount * glyphSize);
+  if(font->mRanges != NULL)
+  {
+    info.mRanges = buffer_align(out) - start;
+    buffer_append(out, font->mRanges, font->mRangeCount * sizeof(GFXrange));
+  }
+  if(font->mFlags & GFX_FONT_LZ)
+  {
+    info.mBlocks = buffer_align(out) - start;
+    buffer_append(out, font->mBlocks, (font->mBlockCount + 1) * sizeof(GFXblock));
+  }
+  info.mBitmap = out->mSize - start;
+  info.mBitmapSize = font_bitmap_size(font, glyphCount);
+  buffer_append(out, font->mBitmap, info.mBitmapSize);
+  if(font->mAdvance != NULL)
+  {
+    info.mAdvance = out->mSize - start;
+    buffer_append(out, font->mAdvance, glyphCount);
+  }
+  if(font->mMetrics != NULL)
+  {
+    info.mMetrics = out->mSize - start;
+    buffer_append(out, font->mMetrics, sizeof(GFXmetrics));
+  }
+
+  memcpy(&out->mData[start], &info, sizeof(info));
+}
+
+static uint32_t bmp_size(const GFXBmp* bmp)
+{
+  uint32_t bits;
+
+  switch(bmp->mMode)
+  {
+    case GFX_COLOR_MODE_MONO: bits = 1; break;
+    case GFX_COLOR_MODE_565:  bits = 16; break;
+    case GFX_COLOR_MODE_888:  bits = 24; break;
+    default:                  bits = 32; break;
+  }
+  return ((bmp->mWidth * bmp->mHeight * bits) + 7) / 8;
+}
+
+static void usage(void)
+{
+  fprintf(stderr,
+    "usage: assetpack [-l] <out.pak>\n"
+    "  out.pak    pack file to write, with the assets listed in " ASSETS "\n"
+    "  -l         list the assets and their sizes\n");
+  exit(1);
+}
+
+/* Main ----------------------------------------------------------------------*/
+
+int main(int argc, char** argv)
+{
+  buffer_t pack = {0};
+  gfx_asset_header_t header = {0};
+  gfx_asset_entry_t* index;
+  const char* outPath = NULL;
+  bool list = false;
+  FILE* out;
+
+  for(int i=1; i < argc; i++)
+  {
+    if(!strcmp(argv[i], "-l"))          { list = true; }
+    else if(argv[i][0] == '-')          { usage(); }
+    else if(outPath == NULL)            { outPath = argv[i]; }
+    else                                { usage(); }
+  }
+
+  if(outPath == NULL)
+  {
+    usage();
+  }
+
+  //the index is sorted by name, so assets can be found with a binary search
+  qsort(sAssets, ASSET_COUNT, sizeof(asset_t), compare_assets);
+  for(int i=0; i < ASSET_COUNT; i++)
+  {
+    if(strlen(sAssets[i].mName) >= GFX_ASSET_NAME_LEN)
+    {
+      fail("asset name %s is longer than %d characters", sAssets[i].mName, GFX_ASSET_NAME_LEN - 1);
+    }
+    if((i > 0) && !strcmp(sAssets[i - 1].mName, sAssets[i].mName))
+    {
+      fail("asset %s is listed twice", sAssets[i].mName);
+    }
+  }
+
+  memcpy(header.mMagic, GFX_ASSET_MAGIC, 4);
+  header.mVersion = GFX_ASSET_VERSION;
+  header.mCount = ASSET_COUNT;
+  buffer_append(&pack, &header, sizeof(header));
+  for(int i=0; i < ASSET_COUNT; i++)
+  {
+    gfx_asset_entry_t entry;
+    memset(&entry, 0, sizeof(entry));
+    buffer_append(&pack, &entry, sizeof(entry));
+  }
+
+  for(int i=0; i < ASSET_COUNT; i++)
+  {
+    const asset_t* asset = &sAssets[i];
+    gfx_asset_entry_t entry;
+
+    memset(&entry, 0, sizeof(entry));
+    strcpy(entry.mName, asset->mName);
+    entry.mOffset = buffer_align(&pack);
+
+    if(asset->mFont != NULL)
+    {
+      entry.mType = GFX_ASSET_FONT;
+      entry.mHeight = asset->mFont->mYAdvance;
+      pack_font(&pack, asset->mFont);
+    }
+    else
+    {
+      entry.mType = GFX_ASSET_BMP;
+      entry.mMode = asset->mBmp->mMode;
+      entry.mWidth = asset->mBmp->mWidth;
+      entry.mHeight = asset->mBmp->mHeight;
+      buffer_append(&pack, asset->mBmp->mData, bmp_size(asset->mBmp));
+    }
+
+    entry.mSize = pack.mSize - entry.mOffset;
+    index = (gfx_asset_entry_t*) &pack.mData[sizeof(header)];
+    memcpy(&index[i], &entry, sizeof(entry));
+
+    if(list)
+    {
+      printf("%-32s %-4s %8u bytes\n", entry.mName, (entry.mType == GFX_ASSET_FONT) ? "font" : "bmp", (unsigned)entry.mSize);
+    }
+  }
+
+  header.mSize = buffer_align(&pack);
+  memcpy(pack.mData, &header, sizeof(header));
+
+  out = fopen(outPath, "wb");
+  if((out == NULL) || (fwrite(pack.mData, 1, pack.mSize, out) != pack.mSize) || (fclose(out) != 0))
+  {
+    fail("can not write %s", outPath);
+  }
+
+  if(list)
+  {
+    printf("%d assets, %u bytes\n", ASSET_COUNT, (unsigned)pack.mSize);
+  }
+
+  free(pack.mData);
+  return 0;
+}
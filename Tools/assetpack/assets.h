@@ -0,0 +1,123 @@
+/**
+  *@file assets.h
+  *@brief assets packed by assetpack. Include the headers of the assets, then list each one in ASSET_LIST with
+  *       ASSET_FONT(GFXfont) or ASSET_BMP(GFXBmp). The C name of an asset is its name in the pack
+  *
+  *  Build with another list: make ASSETS=my_assets.h
+  *
+  */
+#include "../../Fonts/FreeMono12pt7b.h"
+#include "../../Fonts/FreeMono18pt7b.h"
+#include "../../Fonts/FreeMono24pt7b.h"
+#include "../../Fonts/FreeMono9pt7b.h"
+#include "../../Fonts/FreeMonoBold12pt7b.h"
+#include "../../Fonts/FreeMonoBold18pt7b.h"
+#include "../../Fonts/FreeMonoBold24pt7b.h"
+#include "../../Fonts/FreeMonoBold9pt7b.h"
+#include "../../Fonts/FreeMonoBoldOblique12pt7b.h"
+#include "../../Fonts/FreeMonoBoldOblique18pt7b.h"
+#include "../../Fonts/FreeMonoBoldOblique24pt7b.h"
+#include "../../Fonts/FreeMonoBoldOblique9pt7b.h"
+#include "../../Fonts/FreeMonoOblique12pt7b.h"
+#include "../../Fonts/FreeMonoOblique18pt7b.h"
+#include "../../Fonts/FreeMonoOblique24pt7b.h"
+#include "../../Fonts/FreeMonoOblique9pt7b.h"
+#include "../../Fonts/FreeSans12pt7b.h"
+#include "../../Fonts/FreeSans18pt7b.h"
+#include "../../Fonts/FreeSans24pt7b.h"
+#include "../../Fonts/FreeSans9pt7b.h"
+#include "../../Fonts/FreeSansBold12pt7b.h"
+#include "../../Fonts/FreeSansBold18pt7b.h"
+#include "../../Fonts/FreeSansBold24pt7b.h"
+#include "../../Fonts/FreeSansBold9pt7b.h"
+#include "../../Fonts/FreeSansBoldOblique12pt7b.h"
+#include "../../Fonts/FreeSansBoldOblique18pt7b.h"
+#include "../../Fonts/FreeSansBoldOblique24pt7b.h"
+#include "../../Fonts/FreeSansBoldOblique9pt7b.h"
+#include "../../Fonts/FreeSansOblique12pt7b.h"
+#include "../../Fonts/FreeSansOblique18pt7b.h"
+#include "../../Fonts/FreeSansOblique24pt7b.h"
+#include "../../Fonts/FreeSansOblique9pt7b.h"
+#include "../../Fonts/FreeSerif12pt7b.h"
+#include "../../Fonts/FreeSerif18pt7b.h"
+#include "../../Fonts/FreeSerif24pt7b.h"
+#include "../../Fonts/FreeSerif9pt7b.h"
+#include "../../Fonts/FreeSerifBold12pt7b.h"
+#include "../../Fonts/FreeSerifBold18pt7b.h"
+#include "../../Fonts/FreeSerifBold24pt7b.h"
+#include "../../Fonts/FreeSerifBold9pt7b.h"
+#include "../../Fonts/FreeSerifBoldItalic12pt7b.h"
+#include "../../Fonts/FreeSerifBoldItalic18pt7b.h"
+#include "../../Fonts/FreeSerifBoldItalic24pt7b.h"
+#include "../../Fonts/FreeSerifBoldItalic9pt7b.h"
+#include "../../Fonts/FreeSerifItalic12pt7b.h"
+#include "../../Fonts/FreeSerifItalic18pt7b.h"
+#include "../../Fonts/FreeSerifItalic24pt7b.h"
+#include "../../Fonts/FreeSerifItalic9pt7b.h"
+#include "../../Fonts/Org_01.h"
+#include "../../Fonts/Picopixel.h"
+#include "../../Fonts/Tiny3x3a2pt7b.h"
+#include "../../Fonts/TomThumb.h"
+#include "../../Fonts/boron.h"
+#include "../../Fonts/xanadu32.h"
+#include "../../Images/uprev_logo.h"
+#include "../../Images/wheelie.h"
+
+#define ASSET_LIST \
+  ASSET_FONT(FreeMono12pt7b) \
+  ASSET_FONT(FreeMono18pt7b) \
+  ASSET_FONT(FreeMono24pt7b) \
+  ASSET_FONT(FreeMono9pt7b) \
+  ASSET_FONT(FreeMonoBold12pt7b) \
+  ASSET_FONT(FreeMonoBold18pt7b) \
+  ASSET_FONT(FreeMonoBold24pt7b) \
+  ASSET_FONT(FreeMonoBold9pt7b) \
+  ASSET_FONT(FreeMonoBoldOblique12pt7b) \
+  ASSET_FONT(FreeMonoBoldOblique18pt7b) \
+  ASSET_FONT(FreeMonoBoldOblique24pt7b) \
+  ASSET_FONT(FreeMonoBoldOblique9pt7b) \
+  ASSET_FONT(FreeMonoOblique12pt7b) \
+  ASSET_FONT(FreeMonoOblique18pt7b) \
+  ASSET_FONT(FreeMonoOblique24pt7b) \
+  ASSET_FONT(FreeMonoOblique9pt7b) \
+  ASSET_FONT(FreeSans12pt7b) \
+  ASSET_FONT(FreeSans18pt7b) \
+  ASSET_FONT(FreeSans24pt7b) \
+  ASSET_FONT(FreeSans9pt7b) \
+  ASSET_FONT(FreeSansBold12pt7b) \
+  ASSET_FONT(FreeSansBold18pt7b) \
+  ASSET_FONT(FreeSansBold24pt7b) \
+  ASSET_FONT(FreeSansBold9pt7b) \
+  ASSET_FONT(FreeSansBoldOblique12pt7b) \
+  ASSET_FONT(FreeSansBoldOblique18pt7b) \
+  ASSET_FONT(FreeSansBoldOblique24pt7b) \
+  ASSET_FONT(FreeSansBoldOblique9pt7b) \
+  ASSET_FONT(FreeSansOblique12pt7b) \
+  ASSET_FONT(FreeSansOblique18pt7b) \
+  ASSET_FONT(FreeSansOblique24pt7b) \
+  ASSET_FONT(FreeSansOblique9pt7b) \
+  ASSET_FONT(FreeSerif12pt7b) \
+  ASSET_FONT(FreeSerif18pt7b) \
+  ASSET_FONT(FreeSerif24pt7b) \
+  ASSET_FONT(FreeSerif9pt7b) \
+  ASSET_FONT(FreeSerifBold12pt7b) \
+  ASSET_FONT(FreeSerifBold18pt7b) \
+  ASSET_FONT(FreeSerifBold24pt7b) \
+  ASSET_FONT(FreeSerifBold9pt7b) \
+  ASSET_FONT(FreeSerifBoldItalic12pt7b) \
+  ASSET_FONT(FreeSerifBoldItalic18pt7b) \
+  ASSET_FONT(FreeSerifBoldItalic24pt7b) \
+  ASSET_FONT(FreeSerifBoldItalic9pt7b) \
+  ASSET_FONT(FreeSerifItalic12pt7b) \
+  ASSET_FONT(FreeSerifItalic18pt7b) \
+  ASSET_FONT(FreeSerifItalic24pt7b) \
+  ASSET_FONT(FreeSerifItalic9pt7b) \
+  ASSET_FONT(Org_01) \
+  ASSET_FONT(Picopixel) \
+  ASSET_FONT(Tiny3x3a2pt7b) \
+  ASSET_FONT(TomThumb) \
+  ASSET_FONT(Boring_Boron32pt7b) \
+  ASSET_FONT(Xanadu32pt7b) \
+  ASSET_BMP(uprev_logo_blk) \
+  ASSET_BMP(uprev_logo_red) \
+  ASSET_BMP(wheelie_bmp)
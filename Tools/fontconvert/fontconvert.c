@@ -0,0 +1,920 @@
+/**
+  *@file fontconvert.c
+  *@brief Host tool that converts BDF (and TTF, when built with FreeType) fonts into GFXfont headers
+  *
+  *  Glyphs are subset to the requested characters and cropped to their ink, identical glyph bitmaps are stored once,
+  *  and fonts that do not cover a single contiguous ASCII range get a GFXrange table. Glyph data can optionally be run
+  *  length encoded (GFX_FONT_RLE) and compressed in LZ4 blocks (GFX_FONT_LZ). Glyph entries use the 8 byte
+  *  GFXpackedGlyph layout when offsets fit in 16 bits
+  *
+  *  usage: fontconvert [options] <font.bdf|font.ttf> <name>
+  *
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <ctype.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef HAVE_FREETYPE
+#include <ft2build.h>
+#include FT_FREETYPE_H
+#endif
+
+/* Private defines -----------------------------------------------------------*/
+#define MAX_CODEPOINT 0x10FFFF
+#define DEDUP_BUCKETS 4096
+#define LZ_MIN_MATCH 4
+#define LZ_HASH_BITS 12
+
+/* Private types -------------------------------------------------------------*/
+typedef struct {
+  uint32_t mCodepoint;
+  int mWidth, mHeight;          //bitmap size after cropping
+  int mXAdvance;
+  int mXOffset, mYOffset;       //from the cursor (on the baseline) to the top left of the bitmap
+  uint8_t* mData;               //packed bits (or RLE runs), MSB first, rows not padded
+  uint32_t mSize;               //bytes in mData
+  uint32_t mOffset;             //offset in the glyph data after deduplication
+} glyph_t;
+
+typedef struct {
+  glyph_t* mGlyphs;             //sorted by codepoint
+  int mCount;
+  int mCapacity;
+  int mYAdvance;
+} font_t;
+
+typedef struct {
+  uint8_t* mData;
+  uint32_t mSize;
+  uint32_t mCapacity;
+} buffer_t;
+
+/* Private variables ---------------------------------------------------------*/
+static bool* sWanted;           //codepoints to include, indexed by codepoint
+
+/* Private functions ---------------------------------------------------------*/
+
+static void fail(const char* fmt, ...)
+{
+  va_list args;
+  va_start(args, fmt);
+  fprintf(stderr, "fontconvert: ");
+  vfprintf(stderr, fmt, args);
+  fprintf(stderr, "\n");
+  va_end(args);
+  exit(1);
+}
+
+static void* xrealloc(void* ptr, size_t size)
+{
+  ptr = realloc(ptr, size ? size : 1);
+  if(ptr == NULL)
+  {
+    fail("out of memory");
+  }
+  return ptr;
+}
+
+static void buffer_append(buffer_t* buf, const uint8_t* data, uint32_t len)
+{
+  if(buf->mSize + len > buf->mCapacity)
+  {
+    buf->mCapacity = (buf->mSize + len) * 2;
+    buf->mData = (uint8_t*) xrealloc(buf->mData, buf->mCapacity);
+  }
+  memcpy(&buf->mData[buf->mSize], data, len);
+  buf->mSize += len;
+}
+
+static void buffer_byte(buffer_t* buf, uint8_t b)
+{
+  buffer_append(buf, &b, 1);
+}
+
+/**
+ * @brief marks codepoints from a list of values and ranges, e.g. "0x20-0x7E,176,0x410-0x44F"
+ */
+static void parse_charset(const char* list)
+{
+  const char* p = list;
+
+  while(*p)
+  {
+    char* end;
+    unsigned long first = strtoul(p, &end, 0);
+    unsigned long last = first;
+
+    if(end == p)
+    {
+      fail("bad character set '%s'", list);
+    }
+    p = end;
+
+    if(*p == '-')
+    {
+      p++;
+      last = strtoul(p, &end, 0);
+      if(end == p)
+      {
+        fail("bad character set '%s'", list);
+      }
+      p = end;
+    }
+
+    if((last < first) || (last > MAX_CODEPOINT))
+    {
+      fail("bad range in character set '%s'", list);
+    }
+
+    for(unsigned long cp = first; cp <= last; cp++)
+    {
+      sWanted[cp] = true;
+    }
+
+    if(*p == ',')
+    {
+      p++;
+    }
+    else if(*p)
+    {
+      fail("bad character set '%s'", list);
+    }
+  }
+}
+
+/**
+ * @brief marks every character used in a UTF-8 text file, so a font can be subset to the strings of a product
+ */
+static void parse_text_file(const char* path)
+{
+  FILE* file = fopen(path, "rb");
+  int c;
+
+  if(file == NULL)
+  {
+    fail("can't open %s", path);
+  }
+
+  while((c = fgetc(file)) != EOF)
+  {
+    uint32_t cp = (uint32_t)c;
+    int extra = (c >= 0xF0) ? 3 : (c >= 0xE0) ? 2 : (c >= 0xC0) ? 1 : 0;
+
+    if(extra)
+    {
+      cp = c & (0x3F >> extra);
+      for(int i=0; i < extra; i++)
+      {
+        c = fgetc(file);
+        if((c == EOF) || ((c & 0xC0) != 0x80))
+        {
+          fail("%s is not valid UTF-8", path);
+        }
+        cp = (cp << 6) | (c & 0x3F);
+      }
+    }
+
+    if((cp >= 0x20) && (cp <= MAX_CODEPOINT))
+    {
+      sWanted[cp] = true;
+    }
+  }
+
+  fclose(file);
+}
+
+/**
+ * @brief adds a glyph from a bitmap with padded rows, cropping it to its ink
+ * @param rows bitmap rows, MSB first
+ * @param pitch bytes per row
+ * @param top row number of the top row, counting up from the row right above the baseline (row 0)
+ */
+static void add_glyph(font_t* font, uint32_t cp, const uint8_t* rows, int pitch, int width, int height, int advance, int left, int top)
+{
+  int x0 = width, x1 = -1, y0 = height, y1 = -1;
+  glyph_t* glyph;
+
+  #define PIXEL(x,y) ((rows[((y) * pitch) + ((x) >> 3)] >> (7 - ((x) & 7))) & 1)
+
+  for(int y=0; y < height; y++)
+  {
+    for(int x=0; x < width; x++)
+    {
+      if(PIXEL(x,y))
+      {
+        x0 = (x < x0) ? x : x0;
+        x1 = (x > x1) ? x : x1;
+        y0 = (y < y0) ? y : y0;
+        y1 = (y > y1) ? y : y1;
+      }
+    }
+  }
+
+  if(font->mCount == font->mCapacity)
+  {
+    font->mCapacity = font->mCapacity ? (font->mCapacity * 2) : 128;
+    font->mGlyphs = (glyph_t*) xrealloc(font->mGlyphs, font->mCapacity * sizeof(glyph_t));
+  }
+
+  glyph = &font->mGlyphs[font->mCount++];
+  memset(glyph, 0, sizeof(glyph_t));
+  glyph->mCodepoint = cp;
+  glyph->mXAdvance = advance;
+
+  //blank glyphs (spaces) keep only their advance, the same as the existing fonts
+  if(x1 < 0)
+  {
+    glyph->mYOffset = 1;
+    return;
+  }
+
+  glyph->mWidth = x1 - x0 + 1;
+  glyph->mHeight = y1 - y0 + 1;
+  glyph->mXOffset = left + x0;
+  glyph->mYOffset = y0 - top;
+  glyph->mSize = ((glyph->mWidth * glyph->mHeight) + 7) / 8;
+  glyph->mData = (uint8_t*) xrealloc(NULL, glyph->mSize);
+  memset(glyph->mData, 0, glyph->mSize);
+
+  int bit = 0;
+  for(int y = y0; y <= y1; y++)
+  {
+    for(int x = x0; x <= x1; x++, bit++)
+    {
+      if(PIXEL(x,y))
+      {
+        glyph->mData[bit >> 3] |= 0x80 >> (bit & 7);
+      }
+    }
+  }
+
+  #undef PIXEL
+
+  if((glyph->mWidth > 255) || (glyph->mHeight > 255) || (advance > 255) || (advance < 0) ||
+     (glyph->mXOffset < -128) || (glyph->mXOffset > 127) || (glyph->mYOffset < -128) || (glyph->mYOffset > 127))
+  {
+    fail("glyph U+%04X is too large for GFXglyph", (unsigned)cp);
+  }
+}
+
+/**
+ * @brief loads the wanted glyphs of a BDF font
+ */
+static void load_bdf(font_t* font, FILE* file)
+{
+  char line[1024];
+  int ascent = 0, descent = 0, boxHeight = 0;
+  long encoding = -1;
+  int advance = 0, width = 0, height = 0, xoff = 0, yoff = 0;
+  uint8_t* rows = NULL;
+
+  while(fgets(line, sizeof(line), file))
+  {
+    if(sscanf(line, "FONT_ASCENT %d", &ascent) == 1) continue;
+    if(sscanf(line, "FONT_DESCENT %d", &descent) == 1) continue;
+    if(sscanf(line, "FONTBOUNDINGBOX %*d %d", &boxHeight) == 1) continue;
+    if(sscanf(line, "ENCODING %ld", &encoding) == 1) continue;
+    if(sscanf(line, "DWIDTH %d", &advance) == 1) continue;
+    if(sscanf(line, "BBX %d %d %d %d", &width, &height, &xoff, &yoff) == 4) continue;
+
+    if(strncmp(line, "BITMAP", 6) == 0)
+    {
+      int pitch = (width + 7) / 8;
+
+      rows = (uint8_t*) xrealloc(rows, pitch * height);
+      memset(rows, 0, pitch * height);
+
+      for(int y=0; y < height; y++)
+      {
+        if(!fgets(line, sizeof(line), file))
+        {
+          fail("unexpected end of BDF file");
+        }
+
+        for(int i=0; i < pitch && isxdigit((unsigned char)line[i * 2]) && isxdigit((unsigned char)line[(i * 2) + 1]); i++)
+        {
+          unsigned int byte;
+          sscanf(&line[i * 2], "%2x", &byte);
+          rows[(y * pitch) + i] = (uint8_t)byte;
+        }
+      }
+
+      //BDF offsets are to the bottom left of the box, with y up. The row right above the baseline is row 0 of GFX fonts
+      if((encoding >= 0) && (encoding <= MAX_CODEPOINT) && sWanted[encoding])
+      {
+        add_glyph(font, (uint32_t)encoding, rows, pitch, width, height, advance, xoff, yoff + height - 1);
+      }
+      encoding = -1;
+    }
+  }
+
+  free(rows);
+  font->mYAdvance = (ascent + descent) ? (ascent + descent) : boxHeight;
+}
+
+#ifdef HAVE_FREETYPE
+/**
+ * @brief loads the wanted glyphs of any font FreeType can read, rendered in 1 bit
+ */
+static void load_freetype(font_t* font, const char* path, int size, int dpi)
+{
+  FT_Library library;
+  FT_Face face;
+
+  if(FT_Init_FreeType(&library) || FT_New_Face(library, path, 0, &face))
+  {
+    fail("FreeType can't open %s", path);
+  }
+
+  if(FT_Set_Char_Size(face, size << 6, 0, dpi, 0))
+  {
+    fail("can't set size %d", size);
+  }
+
+  for(uint32_t cp = 0; cp <= MAX_CODEPOINT; cp++)
+  {
+    if(!sWanted[cp] || (FT_Get_Char_Index(face, cp) == 0))
+    {
+      continue;
+    }
+
+    if(FT_Load_Char(face, cp, FT_LOAD_TARGET_MONO) || FT_Render_Glyph(face->glyph, FT_RENDER_MODE_MONO))
+    {
+      fail("can't render U+%04X", (unsigned)cp);
+    }
+
+    FT_Bitmap* bitmap = &face->glyph->bitmap;
+    add_glyph(font, cp, bitmap->buffer, bitmap->pitch, bitmap->width, bitmap->rows,
+              face->glyph->advance.x >> 6, face->glyph->bitmap_left, face->glyph->bitmap_top - 1);
+  }
+
+  font->mYAdvance = face->size->metrics.height >> 6;
+
+  FT_Done_Face(face);
+  FT_Done_FreeType(library);
+}
+#endif
+
+static int compare_glyphs(const void* a, const void* b)
+{
+  uint32_t ca = ((const glyph_t*)a)->mCodepoint;
+  uint32_t cb = ((const glyph_t*)b)->mCodepoint;
+  return (ca > cb) - (ca < cb);
+}
+
+/**
+ * @brief replaces a glyph's bits with run lengths (see GFX_FONT_RLE in gfx.h)
+ */
+static void rle_encode(glyph_t* glyph)
+{
+  buffer_t out = {0};
+  int count = glyph->mWidth * glyph->mHeight;
+  int pos = 0;
+  int want = 0;
+
+  while(pos < count)
+  {
+    int run = 0;
+
+    while((pos + run < count) && (((glyph->mData[(pos + run) >> 3] >> (7 - ((pos + run) & 7))) & 1) == want))
+    {
+      run++;
+    }
+    pos += run;
+
+    //long runs are split with an empty run of the other kind
+    while(run > 255)
+    {
+      buffer_byte(&out, 255);
+      buffer_byte(&out, 0);
+      run -= 255;
+    }
+    buffer_byte(&out, (uint8_t)run);
+    want ^= 1;
+  }
+
+  free(glyph->mData);
+  glyph->mData = out.mData;
+  glyph->mSize = out.mSize;
+}
+
+/**
+ * @brief writes an LZ4 sequence length extension
+ */
+static void lz4_length(buffer_t* out, uint32_t len)
+{
+  while(len >= 255)
+  {
+    buffer_byte(out, 255);
+    len -= 255;
+  }
+  buffer_byte(out, (uint8_t)len);
+}
+
+/**
+ * @brief compresses data as one LZ4 block (greedy, hash of the last 4 bytes)
+ * @note follows the format's end of block rules (last 5 bytes are literals, no match starts in the last 12)
+ */
+static void lz4_compress(buffer_t* out, const uint8_t* src, uint32_t len)
+{
+  static int32_t table[1 << LZ_HASH_BITS];
+  uint32_t ip = 0;
+  uint32_t anchor = 0;
+
+  for(int i=0; i < (1 << LZ_HASH_BITS); i++)
+  {
+    table[i] = -1;
+  }
+
+  while(len >= 13 && ip + 12 < len)
+  {
+    uint32_t seq;
+    memcpy(&seq, &src[ip], 4);
+    uint32_t hash = (seq * 2654435761u) >> (32 - LZ_HASH_BITS);
+    int32_t ref = table[hash];
+    table[hash] = ip;
+
+    if((ref < 0) || (ip - ref > 0xFFFF) || memcmp(&src[ref], &src[ip], LZ_MIN_MATCH))
+    {
+      ip++;
+      continue;
+    }
+
+    uint32_t match = LZ_MIN_MATCH;
+    while((ip + match < len - 5) && (src[ref + match] == src[ip + match]))
+    {
+      match++;
+    }
+
+    uint32_t literals = ip - anchor;
+    uint8_t token = (uint8_t)(((literals >= 15) ? 15 : literals) << 4);
+    token |= ((match - LZ_MIN_MATCH) >= 15) ? 15 : (match - LZ_MIN_MATCH);
+    buffer_byte(out, token);
+    if(literals >= 15)
+    {
+      lz4_length(out, literals - 15);
+    }
+    buffer_append(out, &src[anchor], literals);
+    buffer_byte(out, (uint8_t)((ip - ref) & 0xFF));
+    buffer_byte(out, (uint8_t)((ip - ref) >> 8));
+    if(match - LZ_MIN_MATCH >= 15)
+    {
+      lz4_length(out, match - LZ_MIN_MATCH - 15);
+    }
+
+    ip += match;
+    anchor = ip;
+  }
+
+  uint32_t literals = len - anchor;
+  buffer_byte(out, (uint8_t)(((literals >= 15) ? 15 : literals) << 4));
+  if(literals >= 15)
+  {
+    lz4_length(out, literals - 15);
+  }
+  buffer_append(out, &src[anchor], literals);
+}
+
+static uint32_t hash_bytes(const uint8_t* data, uint32_t len)
+{
+  uint32_t hash = 2166136261u;
+  for(uint32_t i=0; i < len; i++)
+  {
+    hash = (hash ^ data[i]) * 16777619u;
+  }
+  return hash;
+}
+
+/**
+ * @brief lays out glyph data, storing identical glyph bitmaps once
+ * @return bytes saved by deduplication
+ */
+static uint32_t pack_glyphs(font_t* font, buffer_t* data)
+{
+  int* buckets = (int*) xrealloc(NULL, DEDUP_BUCKETS * sizeof(int));
+  int* next = (int*) xrealloc(NULL, font->mCount * sizeof(int));
+  uint32_t saved = 0;
+
+  for(int i=0; i < DEDUP_BUCKETS; i++)
+  {
+    buckets[i] = -1;
+  }
+
+  for(int i=0; i < font->mCount; i++)
+  {
+    glyph_t* glyph = &font->mGlyphs[i];
+    uint32_t bucket = hash_bytes(glyph->mData, glyph->mSize) % DEDUP_BUCKETS;
+    int match;
+
+    for(match = buckets[bucket]; match >= 0; match = next[match])
+    {
+      glyph_t* other = &font->mGlyphs[match];
+      if((other->mSize == glyph->mSize) && !memcmp(other->mData, glyph->mData, glyph->mSize))
+      {
+        break;
+      }
+    }
+
+    //blank glyphs point wherever the data is, like the existing fonts
+    if(glyph->mSize == 0)
+    {
+      glyph->mOffset = data->mSize;
+      continue;
+    }
+
+    if(match >= 0)
+    {
+      glyph->mOffset = font->mGlyphs[match].mOffset;
+      saved += glyph->mSize;
+      continue;
+    }
+
+    glyph->mOffset = data->mSize;
+    buffer_append(data, glyph->mData, glyph->mSize);
+    next[i] = buckets[bucket];
+    buckets[bucket] = i;
+  }
+
+  free(buckets);
+  free(next);
+  return saved;
+}
+
+/**
+ * @brief prints a byte array in the layout of the existing font headers
+ */
+static void print_bytes(FILE* out, const uint8_t* data, uint32_t len)
+{
+  for(uint32_t i=0; i < len; i++)
+  {
+    fprintf(out, "%s0x%02X%s", (i % 12) ? " " : "  ", data[i], (i + 1 < len) ? "," : " };\n\n");
+    if(((i % 12) == 11) && (i + 1 < len))
+    {
+      fprintf(out, "\n");
+    }
+  }
+
+  if(len == 0)
+  {
+    fprintf(out, "  0x00 };\n\n");
+  }
+}
+
+static void usage(void)
+{
+  fprintf(stderr,
+    "usage: fontconvert [options] <font> <name>\n"
+    "  font       BDF font"
+#ifdef HAVE_FREETYPE
+    ", or any font FreeType reads (TTF, OTF, ...)"
+#endif
+    "\n"
+    "  name       name of the GFXfont (and prefix of its arrays)\n"
+    "  -c chars   codepoints to include, as values and ranges: 0x20-0x7E,0xB0,0x410-0x44F (default 0x20-0x7E)\n"
+    "  -t file    also include every character used in a UTF-8 text file\n"
+    "  -s size    point size for scalable fonts (default 12)\n"
+    "  -d dpi     resolution for scalable fonts (default 141)\n"
+    "  -r         run length encode glyph bitmaps (GFX_FONT_RLE)\n"
+    "  -a         add a table of glyph advances, so measuring text only reads one byte per glyph\n"
+    "  -m         add precomputed GFXmetrics (ascent, descent, advances), so they are not scanned for at runtime\n"
+    "  -W         always use 12 byte GFXglyph entries (by default 8 byte GFXpackedGlyph entries are used when the\n"
+    "             glyph data fits in 64K)\n"
+    "  -z size    compress glyph data in LZ4 blocks of about this many bytes (GFX_FONT_LZ)\n"
+    "  -o file    write the header to a file instead of stdout\n");
+  exit(1);
+}
+
+/* Main ----------------------------------------------------------------------*/
+
+int main(int argc, char** argv)
+{
+  font_t font = {0};
+  buffer_t data = {0};
+  buffer_t packed = {0};
+  const char* path = NULL;
+  const char* name = NULL;
+  const char* outPath = NULL;
+  bool charsetGiven = false;
+  bool rle = false;
+  bool wide = false;
+  bool withAdvances = false;
+  bool withMetrics = false;
+  int blockSize = 0;
+  int size = 12;
+  int dpi = 141;
+  FILE* out = stdout;
+
+  sWanted = (bool*) xrealloc(NULL, (MAX_CODEPOINT + 1) * sizeof(bool));
+  memset(sWanted, 0, (MAX_CODEPOINT + 1) * sizeof(bool));
+
+  for(int i=1; i < argc; i++)
+  {
+    const char* arg = argv[i];
+    bool hasValue = (i + 1 < argc);
+
+    if(!strcmp(arg, "-c") && hasValue)          { parse_charset(argv[++i]); charsetGiven = true; }
+    else if(!strcmp(arg, "-t") && hasValue)     { parse_text_file(argv[++i]); charsetGiven = true; }
+    else if(!strcmp(arg, "-s") && hasValue)     { size = atoi(argv[++i]); }
+    else if(!strcmp(arg, "-d") && hasValue)     { dpi = atoi(argv[++i]); }
+    else if(!strcmp(arg, "-z") && hasValue)     { blockSize = atoi(argv[++i]); }
+    else if(!strcmp(arg, "-o") && hasValue)     { outPath = argv[++i]; }
+    else if(!strcmp(arg, "-r"))                 { rle = true; }
+    else if(!strcmp(arg, "-W"))                 { wide = true; }
+    else if(!strcmp(arg, "-a"))                 { withAdvances = true; }
+    else if(!strcmp(arg, "-m"))                 { withMetrics = true; }
+    else if(arg[0] == '-')                      { usage(); }
+    else if(path == NULL)                       { path = arg; }
+    else if(name == NULL)                       { name = arg; }
+    else                                        { usage(); }
+  }
+
+  if((path == NULL) || (name == NULL) || (size <= 0) || (dpi <= 0) || (blockSize < 0))
+  {
+    usage();
+  }
+
+  if(!charsetGiven)
+  {
+    parse_charset("0x20-0x7E");
+  }
+
+  //load
+  const char* ext = strrchr(path, '.');
+  if((ext != NULL) && !strcmp(ext, ".bdf"))
+  {
+    FILE* file = fopen(path, "r");
+    if(file == NULL)
+    {
+      fail("can't open %s", path);
+    }
+    load_bdf(&font, file);
+    fclose(file);
+  }
+  else
+  {
+#ifdef HAVE_FREETYPE
+    load_freetype(&font, path, size, dpi);
+#else
+    fail("%s is not a BDF font, and fontconvert was built without FreeType", path);
+#endif
+  }
+
+  if(font.mCount == 0)
+  {
+    fail("the font has none of the requested characters");
+  }
+
+  qsort(font.mGlyphs, font.mCount, sizeof(glyph_t), compare_glyphs);
+
+  uint32_t rawSize = 0;
+  for(int i=0; i < font.mCount; i++)
+  {
+    rawSize += font.mGlyphs[i].mSize;
+    if(rle)
+    {
+      rle_encode(&font.mGlyphs[i]);
+    }
+  }
+
+  uint32_t saved = pack_glyphs(&font, &data);
+
+  //ranges of consecutive codepoints. A single range within 0..255 is stored as mFirst..mLast, and small gaps in
+  //ASCII fonts are filled with empty glyphs when that is smaller than a range table
+  int rangeCount = 1;
+  int gapGlyphs = 0;
+  uint32_t lastCp = font.mGlyphs[font.mCount - 1].mCodepoint;
+  for(int i=1; i < font.mCount; i++)
+  {
+    uint32_t gap = font.mGlyphs[i].mCodepoint - font.mGlyphs[i - 1].mCodepoint - 1;
+    rangeCount += (gap > 0);
+    gapGlyphs += gap;
+  }
+  bool dense = (lastCp <= 0xFF) && ((rangeCount == 1) || (gapGlyphs * 12 <= (rangeCount * 8) + 12));
+
+  //compress in blocks split at glyph bounds, glyph offsets stay in the uncompressed data
+  buffer_t blocks = {0};    //pairs of (compressed offset, uncompressed start)
+  int blockCount = 0;
+  if(blockSize > 0)
+  {
+    uint32_t start = 0;
+    uint32_t* bounds = (uint32_t*) xrealloc(NULL, (font.mCount + 1) * sizeof(uint32_t));
+    int boundCount = 0;
+
+    //distinct glyph starts in the data, in order
+    for(int i=0; i < font.mCount; i++)
+    {
+      if((font.mGlyphs[i].mSize > 0) && (font.mGlyphs[i].mOffset + font.mGlyphs[i].mSize <= data.mSize) &&
+         ((boundCount == 0) || (font.mGlyphs[i].mOffset > bounds[boundCount - 1])))
+      {
+        bounds[boundCount++] = font.mGlyphs[i].mOffset;
+      }
+    }
+    bounds[boundCount++] = data.mSize;
+
+    for(int i=1; i < boundCount; i++)
+    {
+      if((bounds[i] - start >= (uint32_t)blockSize) || (i == boundCount - 1))
+      {
+        uint32_t entry[2] = { packed.mSize, start };
+        buffer_append(&blocks, (const uint8_t*)entry, sizeof(entry));
+        lz4_compress(&packed, &data.mData[start], bounds[i] - start);
+        start = bounds[i];
+        blockCount++;
+      }
+    }
+    free(bounds);
+
+    uint32_t end[2] = { packed.mSize, data.mSize };
+    buffer_append(&blocks, (const uint8_t*)end, sizeof(end));
+  }
+  else
+  {
+    packed = data;
+  }
+
+  //output
+  if(outPath != NULL)
+  {
+    out = fopen(outPath, "w");
+    if(out == NULL)
+    {
+      fail("can't write %s", outPath);
+    }
+  }
+
+  fprintf(out, "// %s generated by fontconvert from %s\n", name, path);
+  fprintf(out, "// %d glyphs, %u bytes of bitmaps before encoding, %u bytes saved by storing identical glyphs once\n\n",
+          font.mCount, (unsigned)rawSize, (unsigned)saved);
+
+  fprintf(out, "static const uint8_t %sBitmaps[]  = {\n", name);
+  print_bytes(out, packed.mData, packed.mSize);
+
+  //8 byte glyph entries when every offset fits in 16 bits
+  bool packedGlyphs = !wide && (data.mSize <= 0xFFFF);
+  int glyphCount = 0;
+  buffer_t advances = {0};
+
+  fprintf(out, "static const %s %sGlyphs[]  = {\n", packedGlyphs ? "GFXpackedGlyph" : "GFXglyph", name);
+  for(int i=0; i < font.mCount; i++)
+  {
+    glyph_t* glyph = &font.mGlyphs[i];
+
+    //empty glyphs for the gaps of dense fonts
+    while(dense && (font.mGlyphs[0].mCodepoint + glyphCount < glyph->mCodepoint))
+    {
+      fprintf(out, "  {     0,   0,   0,   0,    0,    0 },   // 0x%02X (missing)\n", (unsigned)(font.mGlyphs[0].mCodepoint + glyphCount));
+      buffer_byte(&advances, 0);
+      glyphCount++;
+    }
+
+    fprintf(out, "  { %5u, %3d, %3d, %3d, %4d, %4d }%s   // ", (unsigned)glyph->mOffset, glyph->mWidth, glyph->mHeight,
+            glyph->mXAdvance, glyph->mXOffset, glyph->mYOffset, (i + 1 < font.mCount) ? "," : " };");
+    if((glyph->mCodepoint >= 0x20) && (glyph->mCodepoint < 0x7F) && (glyph->mCodepoint != '\\'))
+    {
+      fprintf(out, "0x%02X '%c'\n", (unsigned)glyph->mCodepoint, (char)glyph->mCodepoint);
+    }
+    else
+    {
+      fprintf(out, "U+%04X\n", (unsigned)glyph->mCodepoint);
+    }
+
+    int advance = glyph->mXOffset + glyph->mXAdvance;
+    if(withAdvances && ((advance < 0) || (advance > 255)))
+    {
+      fprintf(stderr, "fontconvert: U+%04X advances %d pixels, which does not fit the advance table. Leaving it out\n", (unsigned)glyph->mCodepoint, advance);
+      withAdvances = false;
+    }
+    buffer_byte(&advances, (uint8_t)advance);
+    glyphCount++;
+  }
+  fprintf(out, "\n");
+
+  if(withMetrics)
+  {
+    //same as the library computes at runtime: glyphs with no ink and no advance (gaps) are left out of the advances
+    int ascent = 0, descent = 0, maxAdvance = 0, total = 0, used = 0, fixed = -1;
+
+    for(int i=0; i < font.mCount; i++)
+    {
+      glyph_t* glyph = &font.mGlyphs[i];
+      int advance = glyph->mXOffset + glyph->mXAdvance;
+
+      ascent = (-glyph->mYOffset > ascent) ? -glyph->mYOffset : ascent;
+      descent = (glyph->mYOffset + glyph->mHeight > descent) ? (glyph->mYOffset + glyph->mHeight) : descent;
+      if((advance == 0) && (glyph->mWidth == 0))
+      {
+        continue;
+      }
+      maxAdvance = (advance > maxAdvance) ? advance : maxAdvance;
+      fixed = ((fixed < 0) || (fixed == advance)) ? advance : 0;
+      total += advance;
+      used++;
+    }
+
+    if((ascent > 127) || (descent > 127) || (maxAdvance > 255))
+    {
+      fprintf(stderr, "fontconvert: font is too large for GFXmetrics. Leaving them out\n");
+      withMetrics = false;
+    }
+    else
+    {
+      fprintf(out, "static const GFXmetrics %sMetrics  = { %d, %d, %d, %d, %d }; // ascent, descent, max/avg/fixed advance\n\n",
+              name, ascent, descent, maxAdvance, used ? ((total + (used / 2)) / used) : 0, (fixed > 0) ? fixed : 0);
+    }
+  }
+
+  if(withAdvances)
+  {
+    fprintf(out, "static const uint8_t %sAdvances[]  = {\n", name);
+    print_bytes(out, advances.mData, advances.mSize);
+  }
+
+  if(!dense)
+  {
+    fprintf(out, "static const GFXrange %sRanges[]  = {\n", name);
+    for(int i=0, start = 0; i < font.mCount; i++)
+    {
+      if((i + 1 == font.mCount) || (font.mGlyphs[i + 1].mCodepoint != font.mGlyphs[i].mCodepoint + 1))
+      {
+        fprintf(out, "  { 0x%04X, %4d, %5d }%s\n", (unsigned)font.mGlyphs[start].mCodepoint, i - start + 1, start,
+                (i + 1 < font.mCount) ? "," : " };");
+        start = i + 1;
+      }
+    }
+    fprintf(out, "\n");
+  }
+
+  if(blockCount > 0)
+  {
+    const uint32_t* entries = (const uint32_t*)blocks.mData;
+
+    fprintf(out, "static const GFXblock %sBlocks[]  = {\n", name);
+    for(int i=0; i <= blockCount; i++)
+    {
+      fprintf(out, "  { %6u, %6u }%s\n", (unsigned)entries[i * 2], (unsigned)entries[(i * 2) + 1], (i < blockCount) ? "," : " };");
+    }
+    fprintf(out, "\n");
+  }
+
+  //every GFXfont field is written, so the header builds cleanly with -Wmissing-field-initializers
+  char flags[64] = "";
+  snprintf(flags, sizeof(flags), "%s%s%s%s%s", rle ? "GFX_FONT_RLE" : "",
+           (rle && blockCount) ? " | " : "", blockCount ? "GFX_FONT_LZ" : "",
+           ((rle || blockCount) && packedGlyphs) ? " | " : "", packedGlyphs ? "GFX_FONT_PACKED" : "");
+
+  fprintf(out, "const GFXfont %s  = {\n", name);
+  fprintf(out, "  (uint8_t  *)%sBitmaps,\n", name);
+  fprintf(out, "  (GFXglyph *)%sGlyphs,\n", name);
+  fprintf(out, "  0x%02X, 0x%02X, %d", dense ? (unsigned)font.mGlyphs[0].mCodepoint : 0, dense ? (unsigned)lastCp : 0, font.mYAdvance);
+  if(dense)
+  {
+    fprintf(out, ",\n  NULL, 0, %s", flags[0] ? flags : "0");
+  }
+  else
+  {
+    fprintf(out, ",\n  %sRanges, %d, %s", name, rangeCount, flags[0] ? flags : "0");
+  }
+  if(blockCount > 0)
+  {
+    fprintf(out, ",\n  %sBlocks, %d", name, blockCount);
+  }
+  else
+  {
+    fprintf(out, ",\n  NULL, 0");
+  }
+  if(withAdvances)
+  {
+    fprintf(out, ",\n  %sAdvances", name);
+  }
+  else
+  {
+    fprintf(out, ",\n  NULL");
+  }
+  if(withMetrics)
+  {
+    fprintf(out, ",\n  &%sMetrics", name);
+  }
+  else
+  {
+    fprintf(out, ",\n  NULL");
+  }
+  fprintf(out, " };\n\n");
+
+  uint32_t total = packed.mSize + (glyphCount * (packedGlyphs ? 8 : 12)) + 12 + (dense ? 0 : rangeCount * 8) +
+                   (blockCount ? (blockCount + 1) * 8 : 0) + (withAdvances ? glyphCount : 0) +
+                   (withMetrics ? 5 : 0);
+  fprintf(out, "// Approx. %u bytes\n", (unsigned)total);
+
+  if(out != stdout)
+  {
+    fclose(out);
+  }
+
+  return 0;
+}
@@ -10,8 +10,28 @@
 #include "gfx.h"
 #include "string.h"
 #include <stdlib.h>
+#include <limits.h>
 #include "gfx_colors.h"
 
+#if !defined(GFX_NO_SIMD)
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define GFX_USE_AVX2
+#endif
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define GFX_USE_SSE2
+#endif
+#if defined(__SSSE3__)
+#include <tmmintrin.h>
+#define GFX_USE_SSSE3
+#endif
+#if defined(__ARM_NEON) && !defined(__ARM_BIG_ENDIAN)
+#include <arm_neon.h>
+#define GFX_USE_NEON
+#endif
+#endif
+
 
 
 
@@ -21,293 +41,4770 @@
 #define _swap_int(a, b) { int t = a; a = b; b = t; }
 #endif
 
+#define GFX_CONVERT_CHUNK 32    //pixels converted per batch by gfx_convert_span (multiple of 8)
+
 /* Private Variables ---------------------------------------------------------*/
+
+//sin(0..90 degrees) in Q14 fixed point
+static const int16_t gfx_sin_table[91] = {
+        0,   286,   572,   857,  1143,  1428,  1713,  1997,  2280,  2563,
+     2845,  3126,  3406,  3686,  3964,  4240,  4516,  4790,  5063,  5334,
+     5604,  5872,  6138,  6402,  6664,  6924,  7182,  7438,  7692,  7943,
+     8192,  8438,  8682,  8923,  9162,  9397,  9630,  9860, 10087, 10311,
+    10531, 10749, 10963, 11174, 11381, 11585, 11786, 11982, 12176, 12365,
+    12551, 12733, 12911, 13085, 13255, 13421, 13583, 13741, 13894, 14044,
+    14189, 14330, 14466, 14598, 14726, 14849, 14968, 15082, 15191, 15296,
+    15396, 15491, 15582, 15668, 15749, 15826, 15897, 15964, 16026, 16083,
+    16135, 16182, 16225, 16262, 16294, 16322, 16344, 16362, 16374, 16382,
+    16384
+};
+
 /* Private functions ---------------------------------------------------------*/
 
 
 
-mrt_status_t gfx_convert_color( gfx_color_t* color, gfx_color_mode_e target)
+/**
+ * @brief packs a color (already converted to the canvas mode) into the byte layout used by the canvas buffer
+ * @note the returned value holds the pixel bytes in memory order, so it can be stored directly into the buffer
+ *       565 pixels are stored big-endian, which is the order most display controllers expect on the bus
+ */
+static uint32_t gfx_pack_color(gfx_color_mode_e mode, const gfx_color_t* color)
 {
-    static uint8_t r;
-    static uint8_t g; 
-    static uint8_t b; 
-    static uint8_t a; 
-    if(target == color->mMode)
+    uint8_t bytes[4] = {0,0,0,0};
+    uint16_t val565;
+    uint32_t packed;
+
+    switch(mode)
     {
-        return MRT_STATUS_OK;
+        case GFX_COLOR_MODE_MONO:
+            bytes[0] = (color->mData.mMonoData.on) ? 0xFF : 0x00;
+            break;
+        case GFX_COLOR_MODE_565:
+            val565 = (color->mData.m565data.r << 11) | (color->mData.m565data.g << 5) | color->mData.m565data.b;
+            bytes[0] = val565 >> 8;
+            bytes[1] = val565 & 0xFF;
+            break;
+        case GFX_COLOR_MODE_888:
+            bytes[0] = color->mData.mRGBdata.r;
+            bytes[1] = color->mData.mRGBdata.g;
+            bytes[2] = color->mData.mRGBdata.b;
+            break;
+        case GFX_COLOR_MODE_888A:
+            bytes[0] = color->mData.mRGBAdata.r;
+            bytes[1] = color->mData.mRGBAdata.g;
+            bytes[2] = color->mData.mRGBAdata.b;
+            bytes[3] = color->mData.mRGBAdata.alpha;
+            break;
+        case GFX_COLOR_MODE_A888:
+            bytes[0] = color->mData.mARGBdata.alpha;
+            bytes[1] = color->mData.mARGBdata.r;
+            bytes[2] = color->mData.mARGBdata.g;
+            bytes[3] = color->mData.mARGBdata.b;
+            break;
+    }
+
+    memcpy(&packed, bytes, sizeof(packed));
+    return packed;
+}
+
+/**
+ * @brief unpacks a pixel from the canvas byte layout back into a gfx_color_t
+ */
+static void gfx_unpack_color(gfx_color_mode_e mode, uint32_t packed, gfx_color_t* color)
+{
+    const uint8_t* bytes = (const uint8_t*)&packed;
+    uint16_t val565;
+
+    color->mData.raw = 0;
+    color->mMode = mode;
+
+    switch(mode)
+    {
+        case GFX_COLOR_MODE_MONO:
+            color->mData.mMonoData.on = (packed != 0);
+            break;
+        case GFX_COLOR_MODE_565:
+            val565 = (bytes[0] << 8) | bytes[1];
+            color->mData.m565data.r = (val565 >> 11) & 0x1F;
+            color->mData.m565data.g = (val565 >> 5) & 0x3F;
+            color->mData.m565data.b = val565 & 0x1F;
+            break;
+        case GFX_COLOR_MODE_888:
+            color->mData.mRGBdata.r = bytes[0];
+            color->mData.mRGBdata.g = bytes[1];
+            color->mData.mRGBdata.b = bytes[2];
+            break;
+        case GFX_COLOR_MODE_888A:
+            color->mData.mRGBAdata.r = bytes[0];
+            color->mData.mRGBAdata.g = bytes[1];
+            color->mData.mRGBAdata.b = bytes[2];
+            color->mData.mRGBAdata.alpha = bytes[3];
+            break;
+        case GFX_COLOR_MODE_A888:
+            color->mData.mARGBdata.alpha = bytes[0];
+            color->mData.mARGBdata.r = bytes[1];
+            color->mData.mARGBdata.g = bytes[2];
+            color->mData.mARGBdata.b = bytes[3];
+            break;
+    }
+}
+
+/**
+ * @brief gets the number of bytes a pixel takes in a row of a color mode (0 for MONO, which packs 8 pixels per byte)
+ */
+static inline uint8_t gfx_mode_bytes(gfx_color_mode_e mode)
+{
+    switch(mode)
+    {
+        case GFX_COLOR_MODE_565:
+            return 2;
+        case GFX_COLOR_MODE_888:
+            return 3;
+        case GFX_COLOR_MODE_888A:
+        case GFX_COLOR_MODE_A888:
+            return 4;
+        default:
+            return 0;
     }
+}
 
-    a = 255;
+/**
+ * @brief decodes a row of pixels into r,g,b,a bytes. The mode is switched on once per row instead of once per pixel
+ * @param mode color mode of source (565, 888, 888A or A888)
+ * @param src ptr to source pixels, in the canvas byte layout of the mode
+ * @param rgba ptr to output, 4 bytes per pixel
+ * @param count number of pixels
+ */
+static void gfx_decode_row(gfx_color_mode_e mode, const uint8_t* src, uint8_t* rgba, int count)
+{
+    int i;
+    uint16_t val;
 
-    switch(color->mMode)
+    switch(mode)
     {
         case GFX_COLOR_MODE_MONO:
-            if(color->mData.mMonoData.on)
+            for(i=0; i < count; i++, rgba += 4)
             {
-                r= 255;
-                g= 255;
-                b = 255;
+                rgba[0] = (src[i >> 3] & (0x80 >> (i & 7))) ? 0xFF : 0x00;
+                rgba[1] = rgba[0];
+                rgba[2] = rgba[0];
+                rgba[3] = 0xFF;
             }
-            else 
+            break;
+        case GFX_COLOR_MODE_565:
+            for(i=0; i < count; i++, src += 2, rgba += 4)
             {
-                r= 0;
-                g= 0;
-                b = 0;
+                val = (src[0] << 8) | src[1];
+                rgba[0] = ((val >> 8) & 0xF8) | (val >> 13);            //replicate the high bits so full scale maps to 255
+                rgba[1] = ((val >> 3) & 0xFC) | ((val >> 9) & 0x03);
+                rgba[2] = ((val << 3) & 0xF8) | ((val >> 2) & 0x07);
+                rgba[3] = 0xFF;
             }
-            break; 
-        case GFX_COLOR_MODE_565:
-            r = color->mData.m565data.r * 8;
-            g = color->mData.m565data.g * 8;
-            b = color->mData.m565data.b * 8;
-            break; 
+            break;
         case GFX_COLOR_MODE_888:
-            r = color->mData.mRGBdata.r;
-            g = color->mData.mRGBdata.g;
-            b = color->mData.mRGBdata.b;
-            break; 
-        case GFX_COLOR_MODE_A888:
-            r = color->mData.mARGBdata.r;
-            g = color->mData.mARGBdata.g;
-            b = color->mData.mARGBdata.b;
-            a = color->mData.mARGBdata.alpha;
+            for(i=0; i < count; i++, src += 3, rgba += 4)
+            {
+                rgba[0] = src[0];
+                rgba[1] = src[1];
+                rgba[2] = src[2];
+                rgba[3] = 0xFF;
+            }
             break;
         case GFX_COLOR_MODE_888A:
-            r = color->mData.mRGBAdata.r;
-            g = color->mData.mRGBAdata.g;
-            b = color->mData.mRGBAdata.b;
-            a = color->mData.mRGBAdata.alpha;
+            memcpy(rgba, src, count * 4);
+            break;
+        case GFX_COLOR_MODE_A888:
+            for(i=0; i < count; i++, src += 4, rgba += 4)
+            {
+                rgba[0] = src[1];
+                rgba[1] = src[2];
+                rgba[2] = src[3];
+                rgba[3] = src[0];
+            }
             break;
     }
+}
 
-    color->mData.raw = 0; 
-    color->mMode = target;
+/**
+ * @brief encodes a row of r,g,b,a pixels into the canvas byte layout of a color mode
+ * @param mode target color mode. MONO pixels are on if any channel is set
+ * @param rgba ptr to input, 4 bytes per pixel
+ * @param dst ptr to output
+ * @param count number of pixels
+ */
+static void gfx_encode_row(gfx_color_mode_e mode, const uint8_t* rgba, uint8_t* dst, int count)
+{
+    int i;
+    uint16_t val;
 
-    switch(target)
+    switch(mode)
     {
         case GFX_COLOR_MODE_MONO:
-            if( r | g| b)
+            memset(dst, 0, (count + 7) / 8);
+            for(i=0; i < count; i++, rgba += 4)
             {
-                color->mData.mMonoData.on = true; 
+                if(rgba[0] | rgba[1] | rgba[2])
+                {
+                    dst[i >> 3] |= 0x80 >> (i & 7);
+                }
             }
-            break; 
+            break;
         case GFX_COLOR_MODE_565:
-            color->mData.m565data.r = r >> 3;
-            color->mData.m565data.g = g >> 2;
-            color->mData.m565data.b = b >> 3;
-            break; 
+            for(i=0; i < count; i++, rgba += 4, dst += 2)
+            {
+                val = ((rgba[0] & 0xF8) << 8) | ((rgba[1] & 0xFC) << 3) | (rgba[2] >> 3);
+                dst[0] = val >> 8;
+                dst[1] = val & 0xFF;
+            }
+            break;
         case GFX_COLOR_MODE_888:
-            color->mData.mRGBdata.r = r;
-            color->mData.mRGBdata.g = g;
-            color->mData.mRGBdata.b = b;
-            break; 
-        case GFX_COLOR_MODE_A888:
-            color->mData.mARGBdata.r = r;
-            color->mData.mARGBdata.g = g;
-            color->mData.mARGBdata.b = b;
-            color->mData.mARGBdata.alpha = a;
+            for(i=0; i < count; i++, rgba += 4, dst += 3)
+            {
+                dst[0] = rgba[0];
+                dst[1] = rgba[1];
+                dst[2] = rgba[2];
+            }
             break;
         case GFX_COLOR_MODE_888A:
-            color->mData.mRGBAdata.r = r;
-            color->mData.mRGBAdata.g = g;
-            color->mData.mRGBAdata.b = b;
-            color->mData.mRGBAdata.alpha = a;
+            memcpy(dst, rgba, count * 4);
+            break;
+        case GFX_COLOR_MODE_A888:
+            for(i=0; i < count; i++, rgba += 4, dst += 4)
+            {
+                dst[0] = rgba[3];
+                dst[1] = rgba[0];
+                dst[2] = rgba[1];
+                dst[3] = rgba[2];
+            }
             break;
     }
+}
 
-    return MRT_STATUS_OK;
+/**
+ * @brief swaps the alpha byte between the front and back of 32 bit pixels (888A <-> A888)
+ * @param toFront true for 888A -> A888, false for A888 -> 888A
+ */
+static void gfx_swizzle_8888(const uint8_t* src, uint8_t* dst, int count, bool toFront)
+{
+    int i = 0;
+
+    //Read as little endian words, moving alpha to the front is a rotate left by one byte
+#if defined(GFX_USE_AVX2)
+    for(; i + 8 <= count; i += 8)
+    {
+        __m256i v = _mm256_loadu_si256((const __m256i*)&src[i * 4]);
+        v = (toFront) ? _mm256_or_si256(_mm256_slli_epi32(v, 8), _mm256_srli_epi32(v, 24))
+                      : _mm256_or_si256(_mm256_srli_epi32(v, 8), _mm256_slli_epi32(v, 24));
+        _mm256_storeu_si256((__m256i*)&dst[i * 4], v);
+    }
+#endif
+#if defined(GFX_USE_SSE2)
+    for(; i + 4 <= count; i += 4)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i*)&src[i * 4]);
+        v = (toFront) ? _mm_or_si128(_mm_slli_epi32(v, 8), _mm_srli_epi32(v, 24))
+                      : _mm_or_si128(_mm_srli_epi32(v, 8), _mm_slli_epi32(v, 24));
+        _mm_storeu_si128((__m128i*)&dst[i * 4], v);
+    }
+#endif
+#if defined(GFX_USE_NEON)
+    for(; i + 4 <= count; i += 4)
+    {
+        uint32x4_t v = vreinterpretq_u32_u8(vld1q_u8(&src[i * 4]));
+        v = (toFront) ? vorrq_u32(vshlq_n_u32(v, 8), vshrq_n_u32(v, 24))
+                      : vorrq_u32(vshrq_n_u32(v, 8), vshlq_n_u32(v, 24));
+        vst1q_u8(&dst[i * 4], vreinterpretq_u8_u32(v));
+    }
+#endif
+
+    for(; i < count; i++)
+    {
+        const uint8_t* s = &src[i * 4];
+        uint8_t* d = &dst[i * 4];
+        uint8_t p0 = s[0], p1 = s[1], p2 = s[2], p3 = s[3];
 
+        d[0] = (toFront) ? p3 : p1;
+        d[1] = (toFront) ? p0 : p2;
+        d[2] = (toFront) ? p1 : p3;
+        d[3] = (toFront) ? p2 : p0;
+    }
 }
 
+/**
+ * @brief packs 888 pixels down to big-endian 565
+ */
+static void gfx_888_to_565(const uint8_t* src, uint8_t* dst, int count)
+{
+    int i = 0;
 
-/* Exported functions ------------------------------------------------------- */
+    //SSE2 has no byte shuffle to split up 3 byte pixels, so x86 needs SSSE3. Pixels 0-3 are taken from the first load
+    //and 4-7 from a second load 8 bytes in, which ends exactly at the last byte of the 8 pixels
+#if defined(GFX_USE_SSSE3)
+    const __m128i rA = _mm_setr_epi8(0, -1, 3, -1, 6, -1, 9, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+    const __m128i gA = _mm_setr_epi8(1, -1, 4, -1, 7, -1, 10, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+    const __m128i bA = _mm_setr_epi8(2, -1, 5, -1, 8, -1, 11, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+    const __m128i rB = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, 4, -1, 7, -1, 10, -1, 13, -1);
+    const __m128i gB = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, 5, -1, 8, -1, 11, -1, 14, -1);
+    const __m128i bB = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, 6, -1, 9, -1, 12, -1, 15, -1);
 
-mrt_status_t gfx_init_buffered(gfx_t* gfx, int width, int height, gfx_color_mode_e mode)
+    for(; i + 8 <= count; i += 8)
+    {
+        __m128i a = _mm_loadu_si128((const __m128i*)&src[i * 3]);
+        __m128i b = _mm_loadu_si128((const __m128i*)&src[(i * 3) + 8]);
+        __m128i r = _mm_or_si128(_mm_shuffle_epi8(a, rA), _mm_shuffle_epi8(b, rB));
+        __m128i g = _mm_or_si128(_mm_shuffle_epi8(a, gA), _mm_shuffle_epi8(b, gB));
+        __m128i bl = _mm_or_si128(_mm_shuffle_epi8(a, bA), _mm_shuffle_epi8(b, bB));
+
+        //each 16 bit lane is stored little endian, so the high byte of the 565 value goes in the low half
+        __m128i hi = _mm_or_si128(_mm_and_si128(r, _mm_set1_epi16(0xF8)), _mm_srli_epi16(g, 5));
+        __m128i lo = _mm_or_si128(_mm_slli_epi16(_mm_and_si128(g, _mm_set1_epi16(0x1C)), 3), _mm_srli_epi16(bl, 3));
+        _mm_storeu_si128((__m128i*)&dst[i * 2], _mm_or_si128(hi, _mm_slli_epi16(lo, 8)));
+    }
+#endif
+#if defined(GFX_USE_NEON)
+    for(; i + 16 <= count; i += 16)
+    {
+        uint8x16x3_t rgb = vld3q_u8(&src[i * 3]);
+        uint8x16x2_t out;
+
+        out.val[0] = vorrq_u8(vandq_u8(rgb.val[0], vdupq_n_u8(0xF8)), vshrq_n_u8(rgb.val[1], 5));
+        out.val[1] = vorrq_u8(vshlq_n_u8(vandq_u8(rgb.val[1], vdupq_n_u8(0x1C)), 3), vshrq_n_u8(rgb.val[2], 3));
+        vst2q_u8(&dst[i * 2], out);
+    }
+#endif
+
+    for(; i < count; i++)
+    {
+        const uint8_t* s = &src[i * 3];
+
+        dst[i * 2] = (s[0] & 0xF8) | (s[1] >> 5);
+        dst[(i * 2) + 1] = ((s[1] & 0x1C) << 3) | (s[2] >> 3);
+    }
+}
+
+/**
+ * @brief expands big-endian 565 pixels to 888, replicating the high bits into the low bits so full scale maps to 255
+ */
+static void gfx_565_to_888(const uint8_t* src, uint8_t* dst, int count)
 {
+    int i = 0;
 
-    switch (mode)
+    //channels are expanded in 16 bit lanes, then shuffled out as 16 + 8 bytes of r,g,b
+#if defined(GFX_USE_SSSE3)
+    const __m128i rgLo = _mm_setr_epi8(0, 1, -1, 2, 3, -1, 4, 5, -1, 6, 7, -1, 8, 9, -1, 10);
+    const __m128i bLo = _mm_setr_epi8(-1, -1, 0, -1, -1, 2, -1, -1, 4, -1, -1, 6, -1, -1, 8, -1);
+    const __m128i rgHi = _mm_setr_epi8(11, -1, 12, 13, -1, 14, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+    const __m128i bHi = _mm_setr_epi8(-1, 10, -1, -1, 12, -1, -1, 14, -1, -1, -1, -1, -1, -1, -1, -1);
+    const __m128i lowByte = _mm_set1_epi16(0xFF);
+
+    for(; i + 8 <= count; i += 8)
     {
-        case GFX_COLOR_MODE_MONO:           //Monochromatic color mode
-            gfx->mPixelSize = 1;
-            break;
-        case GFX_COLOR_MODE_565:            //16bit color mode using 565 format
-            gfx->mPixelSize = 16;
-            break;
-        case GFX_COLOR_MODE_888:          //24 bit color mode 
-            gfx->mPixelSize = 24;
-            break;
-        case GFX_COLOR_MODE_A888:          //24 bit color modes 
-        case GFX_COLOR_MODE_888A:          
-            gfx->mPixelSize = 32;
-            break;
+        __m128i v = _mm_loadu_si128((const __m128i*)&src[i * 2]);
+        __m128i hi = _mm_and_si128(v, lowByte);
+        __m128i lo = _mm_srli_epi16(v, 8);
+        __m128i r = _mm_and_si128(hi, _mm_set1_epi16(0xF8));
+        __m128i g = _mm_and_si128(_mm_or_si128(_mm_slli_epi16(hi, 5), _mm_srli_epi16(_mm_and_si128(lo, _mm_set1_epi16(0xE0)), 3)), lowByte);
+        __m128i b = _mm_and_si128(_mm_slli_epi16(lo, 3), lowByte);
+
+        r = _mm_or_si128(r, _mm_srli_epi16(r, 5));
+        g = _mm_or_si128(g, _mm_srli_epi16(g, 6));
+        b = _mm_or_si128(b, _mm_srli_epi16(b, 5));
+
+        __m128i rg = _mm_or_si128(r, _mm_slli_epi16(g, 8));
+        _mm_storeu_si128((__m128i*)&dst[i * 3], _mm_or_si128(_mm_shuffle_epi8(rg, rgLo), _mm_shuffle_epi8(b, bLo)));
+        _mm_storel_epi64((__m128i*)&dst[(i * 3) + 16], _mm_or_si128(_mm_shuffle_epi8(rg, rgHi), _mm_shuffle_epi8(b, bHi)));
     }
-    
-    gfx->mMode = mode;
-    gfx->mBufferSize = ((width * height) * (gfx->mPixelSize)) / 8;
-    gfx->mBuffer = (uint8_t*) malloc(gfx->mBufferSize);
-    memset(gfx->mBuffer,0,gfx->mBufferSize);
-    gfx->mWidth = width;
-    gfx->mHeight = height;
-    gfx->mFont  = NULL;
-    gfx->fWritePixel = &gfx_write_pixel;
-    gfx->fWriteBuffer = &gfx_write_buffer;
-    gfx->mDevice  = NULL;
-    gfx->mBuffered = true;
-    gfx_set_pen(gfx,1,GFX_COLOR_WHITE);
+#endif
+#if defined(GFX_USE_NEON)
+    for(; i + 16 <= count; i += 16)
+    {
+        uint8x16x2_t in = vld2q_u8(&src[i * 2]);
+        uint8x16x3_t rgb;
+        uint8x16_t r = vandq_u8(in.val[0], vdupq_n_u8(0xF8));
+        uint8x16_t g = vorrq_u8(vshlq_n_u8(in.val[0], 5), vshrq_n_u8(vandq_u8(in.val[1], vdupq_n_u8(0xE0)), 3));
+        uint8x16_t b = vshlq_n_u8(in.val[1], 3);
 
-    return MRT_STATUS_OK;
+        rgb.val[0] = vorrq_u8(r, vshrq_n_u8(r, 5));
+        rgb.val[1] = vorrq_u8(g, vshrq_n_u8(g, 6));
+        rgb.val[2] = vorrq_u8(b, vshrq_n_u8(b, 5));
+        vst3q_u8(&dst[i * 3], rgb);
+    }
+#endif
+
+    for(; i < count; i++)
+    {
+        uint16_t val = (src[i * 2] << 8) | src[(i * 2) + 1];
+        uint8_t* d = &dst[i * 3];
+
+        d[0] = ((val >> 8) & 0xF8) | (val >> 13);
+        d[1] = ((val >> 3) & 0xFC) | ((val >> 9) & 0x03);
+        d[2] = ((val << 3) & 0xF8) | ((val >> 2) & 0x07);
+    }
 }
 
-mrt_status_t gfx_init_unbuffered(gfx_t* gfx, int width, int height, gfx_color_mode_e mode, f_gfx_write_pixel write_cb, void* dev )
+/**
+ * @brief maps a canvas coordinate to a pixel index in the buffer
+ * @note flips are folded into mOrigin/mXStep/mYStep by gfx_set_flags, so there are no flag checks here
+ */
+#define GFX_PIXEL_INDEX(gfx, x, y) ((uint32_t)((gfx)->mOrigin + ((x) * (gfx)->mXStep) + ((y) * (gfx)->mYStep)))
+
+/**
+ * @brief gets the buffer index of the left-most (lowest address) pixel of a horizontal run
+ */
+static inline uint32_t gfx_span_index(const gfx_t* gfx, int x, int y, int len)
 {
+    //a horizontally flipped run covers the same pixels, just starting from the other end
+    return GFX_PIXEL_INDEX(gfx, (gfx->mXStep > 0) ? x : (x + len - 1), y);
+}
 
-    switch (mode)
+/**
+ * @brief sets or clears a run of bits, using whole byte writes for the aligned middle of the run
+ * @param dst ptr to byte containing the first bit
+ * @param bitOffset offset of first bit in dst (0 = MSB)
+ * @param count number of bits
+ * @param on value to set bits to
+ */
+static void gfx_fill_bits(uint8_t* dst, uint32_t bitOffset, uint32_t count, bool on)
+{
+    uint8_t mask;
+
+    //leading partial byte
+    if(bitOffset)
     {
-        case GFX_COLOR_MODE_MONO:           //Monochromatic color mode
-            gfx->mPixelSize = 1;
-            break;
-        case GFX_COLOR_MODE_565:            //16bit color mode using 565 format
-            gfx->mPixelSize = 16;
-            break;
-        case GFX_COLOR_MODE_888:          //24 bit color mode 
-            gfx->mPixelSize = 24;
-            break;
-        case GFX_COLOR_MODE_888A:          //24 bit color modes 
-        case GFX_COLOR_MODE_A888:          
-            gfx->mPixelSize = 32;
-            break;
+        uint32_t n = 8 - bitOffset;
+        if(n > count)
+        {
+            n = count;
+        }
+
+        mask = (uint8_t)((0xFF >> bitOffset) & (0xFF << (8 - bitOffset - n)));
+        *dst = (on) ? (*dst | mask) : (*dst & ~mask);
+        dst++;
+        count -= n;
+    }
+
+    //aligned middle
+    memset(dst, (on) ? 0xFF : 0x00, count >> 3);
+    dst += count >> 3;
+    count &= 7;
+
+    //trailing partial byte
+    if(count)
+    {
+        mask = (uint8_t)(0xFF << (8 - count));
+        *dst = (on) ? (*dst | mask) : (*dst & ~mask);
+    }
+}
+
+/**
+ * @brief reads the next 8 bits of a bit stream, MSB aligned
+ * @param src ptr to bit stream
+ * @param bit bit offset to read from
+ * @param avail number of valid bits remaining from offset (bytes past the end are never read)
+ */
+static inline uint8_t gfx_get_bits8(const uint8_t* src, uint32_t bit, uint32_t avail)
+{
+    const uint8_t* p = &src[bit >> 3];
+    uint32_t shift = bit & 7;
+    uint8_t val = p[0] << shift;
+
+    if(shift && (avail > (8 - shift)))
+    {
+        val |= p[1] >> (8 - shift);
+    }
+
+    return val;
+}
+
+/**
+ * @brief copies a run of bits between two bit streams with any alignment, shifting whole bytes at a time
+ * @param dst ptr to destination stream
+ * @param dstBit bit offset in destination
+ * @param src ptr to source stream
+ * @param srcBit bit offset in source
+ * @param count number of bits to copy
+ */
+static void gfx_copy_bits(uint8_t* dst, uint32_t dstBit, const uint8_t* src, uint32_t srcBit, uint32_t count)
+{
+    uint8_t mask;
+    uint8_t bits;
+
+    dst += dstBit >> 3;
+    dstBit &= 7;
+
+    //same alignment, the middle of the run is a straight byte copy
+    if(dstBit == (srcBit & 7))
+    {
+        src += srcBit >> 3;
+
+        if(dstBit)
+        {
+            uint32_t n = 8 - dstBit;
+            if(n > count)
+            {
+                n = count;
+            }
+
+            mask = (uint8_t)((0xFF >> dstBit) & (0xFF << (8 - dstBit - n)));
+            *dst = (*dst & ~mask) | (*src & mask);
+            dst++;
+            src++;
+            count -= n;
+        }
+
+        if(dst != src)
+        {
+            memcpy(dst, src, count >> 3);
+        }
+        dst += count >> 3;
+        src += count >> 3;
+        count &= 7;
+
+        if(count)
+        {
+            mask = (uint8_t)(0xFF << (8 - count));
+            *dst = (*dst & ~mask) | (*src & mask);
+        }
+        return;
+    }
+
+    //misaligned, shift-merge one destination byte at a time
+    while(count > 0)
+    {
+        uint32_t n = 8 - dstBit;
+        if(n > count)
+        {
+            n = count;
+        }
+
+        bits = gfx_get_bits8(src, srcBit, count);
+        mask = (uint8_t)((0xFF >> dstBit) & (0xFF << (8 - dstBit - n)));
+        *dst = (*dst & ~mask) | ((bits >> dstBit) & mask);
+
+        dst++;
+        srcBit += n;
+        count -= n;
+        dstBit = 0;
+    }
+}
+
+/**
+ * @brief applies a raster op to a run of bits: bits = (bits & andBits) ^ xorBits. The aligned middle is done 32 bits at
+ *        a time
+ * @param dst ptr to byte containing the first bit
+ * @param bitOffset offset of first bit in dst (0 = MSB)
+ * @param count number of bits
+ * @param andBits and mask (0x00 or 0xFF)
+ * @param xorBits xor mask (0x00 or 0xFF)
+ */
+static void gfx_rop_bits(uint8_t* dst, uint32_t bitOffset, uint32_t count, uint8_t andBits, uint8_t xorBits)
+{
+    uint8_t mask;
+    uint32_t and32 = andBits * 0x01010101u;
+    uint32_t xor32 = xorBits * 0x01010101u;
+    uint32_t word;
+
+    //leading partial byte
+    if(bitOffset)
+    {
+        uint32_t n = 8 - bitOffset;
+        if(n > count)
+        {
+            n = count;
+        }
+
+        mask = (uint8_t)((0xFF >> bitOffset) & (0xFF << (8 - bitOffset - n)));
+        *dst = (*dst & (andBits | ~mask)) ^ (xorBits & mask);
+        dst++;
+        count -= n;
+    }
+
+    //aligned middle
+    for(; count >= 32; count -= 32, dst += 4)
+    {
+        memcpy(&word, dst, 4);
+        word = (word & and32) ^ xor32;
+        memcpy(dst, &word, 4);
+    }
+
+    for(; count >= 8; count -= 8, dst++)
+    {
+        *dst = (*dst & andBits) ^ xorBits;
+    }
+
+    //trailing partial byte
+    if(count)
+    {
+        mask = (uint8_t)(0xFF << (8 - count));
+        *dst = (*dst & (andBits | ~mask)) ^ (xorBits & mask);
+    }
+}
+
+/**
+ * @brief applies a raster op to a run of multi-byte pixels: bytes = (bytes & and) ^ xor. Runs are done 12 bytes
+ *        (a whole number of 2, 3 or 4 byte pixels) at a time as three 32 bit ops
+ * @param dst ptr to first pixel
+ * @param count number of pixels
+ * @param size bytes per pixel
+ * @param andPix and mask for one pixel, in the canvas byte layout
+ * @param xorPix xor mask for one pixel, in the canvas byte layout
+ */
+static void gfx_rop_pixels(uint8_t* dst, uint32_t count, uint8_t size, uint32_t andPix, uint32_t xorPix)
+{
+    const uint8_t* andBytes = (const uint8_t*)&andPix;
+    const uint8_t* xorBytes = (const uint8_t*)&xorPix;
+    uint32_t total = count * size;
+    uint32_t i = 0;
+    uint32_t k = 0;
+
+    if(total >= 12)
+    {
+        uint8_t andPat[12];
+        uint8_t xorPat[12];
+        uint32_t andWord[3];
+        uint32_t xorWord[3];
+        uint32_t word;
+        int w;
+
+        for(w=0; w < 12; w++)
+        {
+            andPat[w] = andBytes[w % size];
+            xorPat[w] = xorBytes[w % size];
+        }
+        memcpy(andWord, andPat, 12);
+        memcpy(xorWord, xorPat, 12);
+
+        for(; i + 12 <= total; i += 12)
+        {
+            for(w=0; w < 3; w++)
+            {
+                memcpy(&word, &dst[i + (w * 4)], 4);
+                word = (word & andWord[w]) ^ xorWord[w];
+                memcpy(&dst[i + (w * 4)], &word, 4);
+            }
+        }
+    }
+
+    for(; i < total; i++)
+    {
+        dst[i] = (dst[i] & andBytes[k]) ^ xorBytes[k];
+        k = (k + 1 == size) ? 0 : (k + 1);
+    }
+}
+
+/**
+ * @brief applies a raster op to the destination bits that are set in a source bit stream (transparent blit), shifting
+ *        whole source bytes into place for each destination byte
+ * @param dst ptr to destination stream
+ * @param dstBit bit offset in destination
+ * @param src ptr to source stream
+ * @param srcBit bit offset in source
+ * @param count number of bits
+ * @param andBits and mask applied where the source is set (0x00 or 0xFF)
+ * @param xorBits xor mask applied where the source is set (0x00 or 0xFF)
+ */
+static void gfx_merge_bits(uint8_t* dst, uint32_t dstBit, const uint8_t* src, uint32_t srcBit, uint32_t count, uint8_t andBits, uint8_t xorBits)
+{
+    uint8_t mask;
+
+    dst += dstBit >> 3;
+    dstBit &= 7;
+
+    while(count > 0)
+    {
+        uint32_t n = 8 - dstBit;
+        if(n > count)
+        {
+            n = count;
+        }
+
+        mask = (uint8_t)((0xFF >> dstBit) & (0xFF << (8 - dstBit - n)));
+        mask &= gfx_get_bits8(src, srcBit, count) >> dstBit;
+        *dst = (*dst & (andBits | ~mask)) ^ (xorBits & mask);
+
+        dst++;
+        srcBit += n;
+        count -= n;
+        dstBit = 0;
+    }
+}
+
+/**
+ * @brief fills a multi-byte pixel pattern by doubling the already written region with memcpy
+ */
+static void gfx_fill_pattern(uint8_t* dst, const uint8_t* pattern, uint32_t patternSize, uint32_t count)
+{
+    uint32_t total = patternSize * count;
+    uint32_t done = patternSize;
+
+    if(count == 0)
+    {
+        return;
+    }
+
+    memcpy(dst, pattern, patternSize);
+    while(done < total)
+    {
+        uint32_t n = (done < (total - done)) ? done : (total - done);
+        memcpy(&dst[done], dst, n);
+        done += n;
+    }
+}
+
+/* Run writers: write 'count' identical pixels starting at a buffer pixel index. Runs may cross rows */
+
+static void gfx_run_mono(gfx_t* gfx, uint32_t idx, uint32_t count, uint32_t color)
+{
+    gfx_fill_bits(&gfx->mBuffer[idx >> 3], idx & 7, count, (color != 0));
+}
+
+static void gfx_run_565(gfx_t* gfx, uint32_t idx, uint32_t count, uint32_t color)
+{
+    const uint8_t* bytes = (const uint8_t*)&color;
+
+    if(bytes[0] == bytes[1])
+    {
+        memset(&gfx->mBuffer[idx * 2], bytes[0], count * 2);
+    }
+    else
+    {
+        uint16_t* dst = (uint16_t*) &gfx->mBuffer[idx * 2];
+        uint16_t val;
+        memcpy(&val, bytes, 2);
+        while(count--)
+        {
+            *dst++ = val;
+        }
+    }
+}
+
+static void gfx_run_888(gfx_t* gfx, uint32_t idx, uint32_t count, uint32_t color)
+{
+    const uint8_t* bytes = (const uint8_t*)&color;
+
+    if((bytes[0] == bytes[1]) && (bytes[1] == bytes[2]))
+    {
+        memset(&gfx->mBuffer[idx * 3], bytes[0], count * 3);
+    }
+    else
+    {
+        gfx_fill_pattern(&gfx->mBuffer[idx * 3], bytes, 3, count);
+    }
+}
+
+static void gfx_run_8888(gfx_t* gfx, uint32_t idx, uint32_t count, uint32_t color)
+{
+    const uint8_t* bytes = (const uint8_t*)&color;
+
+    if((bytes[0] == bytes[1]) && (bytes[1] == bytes[2]) && (bytes[2] == bytes[3]))
+    {
+        memset(&gfx->mBuffer[idx * 4], bytes[0], count * 4);
+    }
+    else
+    {
+        uint32_t* dst = (uint32_t*) &gfx->mBuffer[idx * 4];
+        while(count--)
+        {
+            *dst++ = color;
+        }
+    }
+}
+
+/**
+ * @brief writes a run of identical pixels starting at a buffer pixel index
+ */
+static void gfx_fill_run(gfx_t* gfx, uint32_t idx, uint32_t count, uint32_t color)
+{
+    switch(gfx->mMode)
+    {
+        case GFX_COLOR_MODE_MONO:
+            gfx_run_mono(gfx, idx, count, color);
+            break;
+        case GFX_COLOR_MODE_565:
+            gfx_run_565(gfx, idx, count, color);
+            break;
+        case GFX_COLOR_MODE_888:
+            gfx_run_888(gfx, idx, count, color);
+            break;
+        case GFX_COLOR_MODE_888A:
+        case GFX_COLOR_MODE_A888:
+            gfx_run_8888(gfx, idx, count, color);
+            break;
+    }
+}
+
+/* Pixel writers: installed in fPlot at init. Coordinates are already clipped, color is packed */
+
+static void gfx_plot_mono(gfx_t* gfx, int x, int y, uint32_t color)
+{
+    uint32_t idx = GFX_PIXEL_INDEX(gfx, x, y);
+    uint8_t mask = 0x80 >> (idx & 7);
+
+    if(color)
+    {
+        gfx->mBuffer[idx >> 3] |= mask;
+    }
+    else
+    {
+        gfx->mBuffer[idx >> 3] &= (~mask);
+    }
+}
+
+static void gfx_plot_565(gfx_t* gfx, int x, int y, uint32_t color)
+{
+    memcpy(&gfx->mBuffer[GFX_PIXEL_INDEX(gfx, x, y) * 2], &color, 2);
+}
+
+static void gfx_plot_888(gfx_t* gfx, int x, int y, uint32_t color)
+{
+    memcpy(&gfx->mBuffer[GFX_PIXEL_INDEX(gfx, x, y) * 3], &color, 3);
+}
+
+static void gfx_plot_8888(gfx_t* gfx, int x, int y, uint32_t color)
+{
+    memcpy(&gfx->mBuffer[GFX_PIXEL_INDEX(gfx, x, y) * 4], &color, 4);
+}
+
+static void gfx_plot_cb(gfx_t* gfx, int x, int y, uint32_t color)
+{
+    gfx_color_t val;
+    gfx_unpack_color(gfx->mMode, color, &val);
+    gfx->fWritePixel(gfx, x, y, &val);
+}
+
+/* Span writers: installed in fSpan at init. Coordinates are already clipped, color is packed */
+
+static void gfx_span_mono(gfx_t* gfx, int x, int y, int len, uint32_t color)
+{
+    gfx_run_mono(gfx, gfx_span_index(gfx, x, y, len), len, color);
+}
+
+static void gfx_span_565(gfx_t* gfx, int x, int y, int len, uint32_t color)
+{
+    gfx_run_565(gfx, gfx_span_index(gfx, x, y, len), len, color);
+}
+
+static void gfx_span_888(gfx_t* gfx, int x, int y, int len, uint32_t color)
+{
+    gfx_run_888(gfx, gfx_span_index(gfx, x, y, len), len, color);
+}
+
+static void gfx_span_8888(gfx_t* gfx, int x, int y, int len, uint32_t color)
+{
+    gfx_run_8888(gfx, gfx_span_index(gfx, x, y, len), len, color);
+}
+
+static void gfx_span_cb(gfx_t* gfx, int x, int y, int len, uint32_t color)
+{
+    gfx_color_t val;
+    gfx_unpack_color(gfx->mMode, color, &val);
+
+    for(int i=0; i < len; i++)
+    {
+        gfx->fWritePixel(gfx, x + i, y, &val);
+    }
+}
+
+/* Blend writers: installed by gfx_set_pen for a translucent pen. They blend mPen.mRGBA and ignore the packed color */
+
+/**
+ * @brief divides by 255 with rounding (exact for 0 - 65535)
+ */
+static inline uint8_t gfx_div255(uint32_t val)
+{
+    val += 128;
+    return (uint8_t)((val + (val >> 8)) >> 8);
+}
+
+/**
+ * @brief blends a straight alpha r,g,b,a color over one pixel of the buffer (source-over)
+ * @param dst ptr to pixel in buffer
+ * @param rgba color to blend
+ */
+static void gfx_blend_pixel(gfx_t* gfx, uint8_t* dst, const uint8_t* rgba)
+{
+    uint8_t a = rgba[3];
+    uint8_t inv = 255 - a;
+    uint8_t d[4];
+    int i;
+
+    if(a == 0)
+    {
+        return;
+    }
+
+    gfx_decode_row(gfx->mMode, dst, d, 1);
+
+    if((a == 255) || ((d[3] == 0) && !(gfx->mFlags & GFX_FLAG_PREMULTIPLIED)))
+    {
+        memcpy(d, rgba, 4);
+    }
+    else if((d[3] == 255) || (gfx->mFlags & GFX_FLAG_PREMULTIPLIED))
+    {
+        //opaque or premultiplied destination, every channel (alpha included) is s*a + d*(1-a)
+        for(i=0; i < 3; i++)
+        {
+            d[i] = gfx_div255((rgba[i] * a) + (d[i] * inv));
+        }
+        d[3] = gfx_div255((255 * a) + (d[3] * inv));
+    }
+    else
+    {
+        //straight alpha over a translucent destination needs the divide by the resulting alpha
+        uint32_t dstWeight = (uint32_t)d[3] * inv;
+        uint32_t outA = a + gfx_div255(dstWeight);
+
+        for(i=0; i < 3; i++)
+        {
+            d[i] = (uint8_t)((((uint32_t)rgba[i] * a * 255) + (d[i] * dstWeight) + ((outA * 255) / 2)) / (outA * 255));
+        }
+        d[3] = (uint8_t)outA;
+    }
+
+    gfx_encode_row(gfx->mMode, d, dst, 1);
+}
+
+/**
+ * @brief blends a constant color over a run of bytes: dst = (term + dst * inv) / 255
+ * @note the source terms repeat every 'period' bytes (one pixel). Vector loops handle 48 bytes at a time, which is a
+ *       whole number of both 3 and 4 byte pixels (16 888 pixels or 12 8888 pixels)
+ * @param dst ptr to first byte
+ * @param count number of bytes
+ * @param term source color times alpha for each byte of a pixel
+ * @param period bytes per pixel (3 or 4)
+ * @param inv 255 - alpha
+ */
+static void gfx_blend_bytes(uint8_t* dst, uint32_t count, const uint16_t* term, uint8_t period, uint8_t inv)
+{
+    uint32_t i = 0;
+    uint8_t k = 0;
+
+#if defined(GFX_USE_SSE2) || defined(GFX_USE_NEON)
+    if(count >= 48)
+    {
+        uint16_t block[48];
+        int b;
+
+        for(b=0; b < 48; b++)
+        {
+            block[b] = term[b % period];
+        }
+
+#if defined(GFX_USE_SSE2)
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i vinv = _mm_set1_epi16(inv);
+        const __m128i round = _mm_set1_epi16(128);
+
+        for(; i + 48 <= count; i += 48)
+        {
+            for(b=0; b < 3; b++)
+            {
+                __m128i v = _mm_loadu_si128((const __m128i*)&dst[i + (b * 16)]);
+                __m128i lo = _mm_mullo_epi16(_mm_unpacklo_epi8(v, zero), vinv);
+                __m128i hi = _mm_mullo_epi16(_mm_unpackhi_epi8(v, zero), vinv);
+
+                lo = _mm_add_epi16(_mm_add_epi16(lo, _mm_loadu_si128((const __m128i*)&block[b * 16])), round);
+                hi = _mm_add_epi16(_mm_add_epi16(hi, _mm_loadu_si128((const __m128i*)&block[(b * 16) + 8])), round);
+                lo = _mm_srli_epi16(_mm_add_epi16(lo, _mm_srli_epi16(lo, 8)), 8);
+                hi = _mm_srli_epi16(_mm_add_epi16(hi, _mm_srli_epi16(hi, 8)), 8);
+                _mm_storeu_si128((__m128i*)&dst[i + (b * 16)], _mm_packus_epi16(lo, hi));
+            }
+        }
+#elif defined(GFX_USE_NEON)
+        const uint8x8_t vinv = vdup_n_u8(inv);
+        const uint16x8_t round = vdupq_n_u16(128);
+
+        for(; i + 48 <= count; i += 48)
+        {
+            for(b=0; b < 3; b++)
+            {
+                uint8x16_t v = vld1q_u8(&dst[i + (b * 16)]);
+                uint16x8_t lo = vmlal_u8(vld1q_u16(&block[b * 16]), vget_low_u8(v), vinv);
+                uint16x8_t hi = vmlal_u8(vld1q_u16(&block[(b * 16) + 8]), vget_high_u8(v), vinv);
+
+                lo = vaddq_u16(lo, round);
+                hi = vaddq_u16(hi, round);
+                lo = vshrq_n_u16(vaddq_u16(lo, vshrq_n_u16(lo, 8)), 8);
+                hi = vshrq_n_u16(vaddq_u16(hi, vshrq_n_u16(hi, 8)), 8);
+                vst1q_u8(&dst[i + (b * 16)], vcombine_u8(vmovn_u16(lo), vmovn_u16(hi)));
+            }
+        }
+#endif
+    }
+#endif
+
+    for(; i < count; i++)
+    {
+        dst[i] = gfx_div255(term[k] + (dst[i] * inv));
+        k = (k + 1 == period) ? 0 : (k + 1);
+    }
+}
+
+static void gfx_plot_blend(gfx_t* gfx, int x, int y, uint32_t color)
+{
+    (void)color;    //blends the pen color
+    gfx_blend_pixel(gfx, &gfx->mBuffer[GFX_PIXEL_INDEX(gfx, x, y) * gfx_mode_bytes(gfx->mMode)], gfx->mPen.mRGBA);
+}
+
+static void gfx_span_blend(gfx_t* gfx, int x, int y, int len, uint32_t color)
+{
+    uint8_t size = gfx_mode_bytes(gfx->mMode);
+    uint8_t* dst = &gfx->mBuffer[gfx_span_index(gfx, x, y, len) * size];
+    const uint8_t* rgba = gfx->mPen.mRGBA;
+    uint8_t a = rgba[3];
+    uint16_t term[4];
+
+    (void)color;    //blends the pen color
+
+    //888 and premultiplied 8888 rows blend every byte the same way, so they can be done as a byte stream
+    switch(gfx->mMode)
+    {
+        case GFX_COLOR_MODE_888:
+            term[0] = rgba[0] * a;
+            term[1] = rgba[1] * a;
+            term[2] = rgba[2] * a;
+            gfx_blend_bytes(dst, len * 3, term, 3, 255 - a);
+            return;
+        case GFX_COLOR_MODE_888A:
+        case GFX_COLOR_MODE_A888:
+            if(gfx->mFlags & GFX_FLAG_PREMULTIPLIED)
+            {
+                uint8_t first = (gfx->mMode == GFX_COLOR_MODE_A888) ? 1 : 0;
+
+                term[first] = rgba[0] * a;
+                term[first + 1] = rgba[1] * a;
+                term[first + 2] = rgba[2] * a;
+                term[(first) ? 0 : 3] = 255 * a;
+                gfx_blend_bytes(dst, len * 4, term, 4, 255 - a);
+                return;
+            }
+            break;
+        default:
+            break;
+    }
+
+    for(int i=0; i < len; i++)
+    {
+        gfx_blend_pixel(gfx, &dst[i * size], rgba);
+    }
+}
+
+/* Raster op writers: installed by gfx_set_rop for any op other than copy. They apply mPen.mRopAnd/mRopXor */
+
+static void gfx_plot_rop(gfx_t* gfx, int x, int y, uint32_t color)
+{
+    uint32_t idx = GFX_PIXEL_INDEX(gfx, x, y);
+
+    (void)color;    //applies the pen raster op
+
+    if(gfx->mMode == GFX_COLOR_MODE_MONO)
+    {
+        gfx_rop_bits(&gfx->mBuffer[idx >> 3], idx & 7, 1, (uint8_t)gfx->mPen.mRopAnd, (uint8_t)gfx->mPen.mRopXor);
+    }
+    else
+    {
+        uint8_t size = gfx_mode_bytes(gfx->mMode);
+        gfx_rop_pixels(&gfx->mBuffer[idx * size], 1, size, gfx->mPen.mRopAnd, gfx->mPen.mRopXor);
+    }
+}
+
+static void gfx_span_rop(gfx_t* gfx, int x, int y, int len, uint32_t color)
+{
+    uint32_t idx = gfx_span_index(gfx, x, y, len);
+
+    (void)color;    //applies the pen raster op
+
+    if(gfx->mMode == GFX_COLOR_MODE_MONO)
+    {
+        gfx_rop_bits(&gfx->mBuffer[idx >> 3], idx & 7, len, (uint8_t)gfx->mPen.mRopAnd, (uint8_t)gfx->mPen.mRopXor);
+    }
+    else
+    {
+        uint8_t size = gfx_mode_bytes(gfx->mMode);
+        gfx_rop_pixels(&gfx->mBuffer[idx * size], len, size, gfx->mPen.mRopAnd, gfx->mPen.mRopXor);
+    }
+}
+
+/**
+ * @brief sets pixel size and installs the pixel/span writers for the canvas color mode
+ * @param gfx ptr to gfx canvas
+ * @param mode color mode of canvas
+ * @param direct true if the writers should go straight to mBuffer, false to go through fWritePixel
+ */
+static void gfx_select_writers(gfx_t* gfx, gfx_color_mode_e mode, bool direct)
+{
+    switch (mode)
+    {
+        case GFX_COLOR_MODE_MONO:           //Monochromatic color mode
+            gfx->mPixelSize = 1;
+            gfx->fPlot = &gfx_plot_mono;
+            gfx->fSpan = &gfx_span_mono;
+            break;
+        case GFX_COLOR_MODE_565:            //16bit color mode using 565 format
+            gfx->mPixelSize = 16;
+            gfx->fPlot = &gfx_plot_565;
+            gfx->fSpan = &gfx_span_565;
+            break;
+        case GFX_COLOR_MODE_888:          //24 bit color mode 
+            gfx->mPixelSize = 24;
+            gfx->fPlot = &gfx_plot_888;
+            gfx->fSpan = &gfx_span_888;
+            break;
+        case GFX_COLOR_MODE_888A:          //24 bit color modes 
+        case GFX_COLOR_MODE_A888:          
+            gfx->mPixelSize = 32;
+            gfx->fPlot = &gfx_plot_8888;
+            gfx->fSpan = &gfx_span_8888;
+            break;
+    }
+
+    if(!direct)
+    {
+        gfx->fPlot = &gfx_plot_cb;
+        gfx->fSpan = &gfx_span_cb;
+    }
+}
+
+/**
+ * @brief installs the writers for the current pen. Raster ops other than copy take priority, then a translucent pen
+ *        blends on buffered color canvases. Canvases that can not be read back (callback, or MONO for blending) copy
+ */
+static void gfx_select_pen_writers(gfx_t* gfx)
+{
+    bool direct = (gfx->fWritePixel == &gfx_write_pixel);
+    const uint8_t* pen = (const uint8_t*)&gfx->mPen.mPacked;
+    uint8_t andBytes[4];
+    uint8_t xorBytes[4];
+    int alpha = (gfx->mMode == GFX_COLOR_MODE_888A) ? 3 : (gfx->mMode == GFX_COLOR_MODE_A888) ? 0 : -1;
+
+    //Express the raster op as pixel = (pixel & and) ^ xor, so one kernel handles all of them
+    for(int i=0; i < 4; i++)
+    {
+        uint8_t p = (gfx->mMode == GFX_COLOR_MODE_MONO) ? pen[0] : pen[i];
+        bool keep = (i == alpha);
+
+        switch(gfx->mPen.mRop)
+        {
+            case GFX_ROP_XOR:
+                andBytes[i] = 0xFF;
+                xorBytes[i] = (keep) ? 0x00 : p;
+                break;
+            case GFX_ROP_INVERT:
+                andBytes[i] = 0xFF;
+                xorBytes[i] = (keep) ? 0x00 : 0xFF;
+                break;
+            case GFX_ROP_AND:
+                andBytes[i] = (keep) ? 0xFF : p;
+                xorBytes[i] = 0x00;
+                break;
+            case GFX_ROP_OR:
+                andBytes[i] = (keep) ? 0xFF : (uint8_t)~p;
+                xorBytes[i] = (keep) ? 0x00 : p;
+                break;
+            default:
+                andBytes[i] = 0x00;
+                xorBytes[i] = p;
+                break;
+        }
+    }
+    memcpy(&gfx->mPen.mRopAnd, andBytes, 4);
+    memcpy(&gfx->mPen.mRopXor, xorBytes, 4);
+
+    gfx_select_writers(gfx, gfx->mMode, direct);
+
+    if(!direct || (gfx->mBuffer == NULL))
+    {
+        return;
+    }
+
+    if(gfx->mPen.mRop != GFX_ROP_COPY)
+    {
+        gfx->fPlot = &gfx_plot_rop;
+        gfx->fSpan = &gfx_span_rop;
+    }
+    else if((gfx->mMode != GFX_COLOR_MODE_MONO) && (gfx->mPen.mRGBA[3] < 255))
+    {
+        gfx->fPlot = &gfx_plot_blend;
+        gfx->fSpan = &gfx_span_blend;
+    }
+}
+
+/**
+ * @brief checks if the installed writers just store the color they are given (no pen effects like blending or raster ops)
+ */
+static inline bool gfx_writes_plain(const gfx_t* gfx)
+{
+    return (gfx->fPlot != &gfx_plot_blend) && (gfx->fPlot != &gfx_plot_rop);
+}
+
+/**
+ * @brief gets the pixel writer that stores colors as is, whatever writers the pen has installed
+ */
+static f_gfx_plot gfx_plain_plot(const gfx_t* gfx)
+{
+    if(gfx->fWritePixel != &gfx_write_pixel)
+    {
+        return &gfx_plot_cb;
+    }
+
+    switch(gfx->mMode)
+    {
+        case GFX_COLOR_MODE_MONO:
+            return &gfx_plot_mono;
+        case GFX_COLOR_MODE_565:
+            return &gfx_plot_565;
+        case GFX_COLOR_MODE_888:
+            return &gfx_plot_888;
+        default:
+            return &gfx_plot_8888;
+    }
+}
+
+/**
+ * @brief gets the span writer that stores colors as is, whatever writers the pen has installed
+ */
+static f_gfx_span gfx_plain_span(const gfx_t* gfx)
+{
+    if(gfx->fWritePixel != &gfx_write_pixel)
+    {
+        return &gfx_span_cb;
+    }
+
+    switch(gfx->mMode)
+    {
+        case GFX_COLOR_MODE_MONO:
+            return &gfx_span_mono;
+        case GFX_COLOR_MODE_565:
+            return &gfx_span_565;
+        case GFX_COLOR_MODE_888:
+            return &gfx_span_888;
+        default:
+            return &gfx_span_8888;
+    }
+}
+
+#define GFX_CLIP_X1(gfx) ((int)(gfx)->mClip.mX + (gfx)->mClip.mWidth)    //first column right of the clip rect
+#define GFX_CLIP_Y1(gfx) ((int)(gfx)->mClip.mY + (gfx)->mClip.mHeight)   //first row below the clip rect
+
+/**
+ * @brief intersects a rectangle with the clip rect
+ * @return false if nothing is left
+ */
+static inline bool gfx_clip_rect(const gfx_t* gfx, int* x, int* y, int* w, int* h)
+{
+    //far corners are found in 64 bits, so any rectangle of int coords is handled
+    int64_t x1 = (int64_t)*x + *w;
+    int64_t y1 = (int64_t)*y + *h;
+
+    *x = (*x < gfx->mClip.mX) ? gfx->mClip.mX : *x;
+    *y = (*y < gfx->mClip.mY) ? gfx->mClip.mY : *y;
+    x1 = (x1 > GFX_CLIP_X1(gfx)) ? GFX_CLIP_X1(gfx) : x1;
+    y1 = (y1 > GFX_CLIP_Y1(gfx)) ? GFX_CLIP_Y1(gfx) : y1;
+
+    if((x1 <= *x) || (y1 <= *y))
+    {
+        *w = 0;
+        *h = 0;
+        return false;
+    }
+
+    *w = (int)(x1 - *x);
+    *h = (int)(y1 - *y);
+
+    return true;
+}
+
+/**
+ * @brief writes a single pixel if it is inside the clip rect
+ */
+static inline void gfx_plot_clipped(gfx_t* gfx, int x, int y, uint32_t color)
+{
+    if((x >= gfx->mClip.mX) && (x < GFX_CLIP_X1(gfx)) && (y >= gfx->mClip.mY) && (y < GFX_CLIP_Y1(gfx)))
+    {
+        gfx->fPlot(gfx, x, y, color);
+    }
+}
+
+/**
+ * @brief draws a horizontal run of pixels. The run is clipped once, then handed to the span writer
+ * @param gfx ptr to gfx canvas
+ * @param x x coord of first pixel
+ * @param y y coord of row
+ * @param len number of pixels
+ * @param color packed color to write
+ */
+static void gfx_write_span(gfx_t* gfx, int x, int y, int len, uint32_t color)
+{
+    if((y < gfx->mClip.mY) || (y >= GFX_CLIP_Y1(gfx)) || (len <= 0))
+    {
+        return;
+    }
+
+    //the distance to the clip rect may not fit an int
+    if(x < gfx->mClip.mX)
+    {
+        int64_t cut = (int64_t)gfx->mClip.mX - x;
+        len = (cut >= len) ? 0 : (int)(len - cut);
+        x = gfx->mClip.mX;
+    }
+
+    if(len > GFX_CLIP_X1(gfx) - x)
+    {
+        len = GFX_CLIP_X1(gfx) - x;
+    }
+
+    if(len > 0)
+    {
+        gfx->fSpan(gfx, x, y, len, color);
+    }
+}
+
+/**
+ * @brief draws a vertical run of pixels. The run is clipped once, then handed to the pixel writer
+ * @param gfx ptr to gfx canvas
+ * @param x x coord of column
+ * @param y y coord of first pixel
+ * @param len number of pixels
+ * @param color packed color to write
+ */
+static void gfx_write_vspan(gfx_t* gfx, int x, int y, int len, uint32_t color)
+{
+    if((x < gfx->mClip.mX) || (x >= GFX_CLIP_X1(gfx)) || (len <= 0))
+    {
+        return;
+    }
+
+    //the distance to the clip rect may not fit an int
+    if(y < gfx->mClip.mY)
+    {
+        int64_t cut = (int64_t)gfx->mClip.mY - y;
+        len = (cut >= len) ? 0 : (int)(len - cut);
+        y = gfx->mClip.mY;
+    }
+
+    if(len > GFX_CLIP_Y1(gfx) - y)
+    {
+        len = GFX_CLIP_Y1(gfx) - y;
+    }
+
+    for(int i=0; i < len; i++)
+    {
+        gfx->fPlot(gfx, x, y + i, color);
+    }
+}
+
+/**
+ * @brief draws a single pixel wide line. The line is clipped to the clip rect before stepping
+ * @note Clipping is done on the Bresenham step index (Liang-Barsky style) instead of moving the endpoints, so exactly the
+ *       same pixels are drawn as for the unclipped line, and no time is spent stepping through pixels outside of the clip rect
+ * @param gfx ptr to gfx canvas
+ * @param lastPixel false to leave out the pixel at (x1,y1), so lines that share an end point only write it once
+ * @param color packed color to write
+ */
+static void gfx_write_line(gfx_t* gfx, int x0, int y0, int x1, int y1, bool lastPixel, uint32_t color)
+{
+    int minX = gfx->mClip.mX;
+    int minY = gfx->mClip.mY;
+    int maxX = GFX_CLIP_X1(gfx) - 1;
+    int maxY = GFX_CLIP_Y1(gfx) - 1;
+    int skip = lastPixel ? 0 : 1;
+
+    //Axis aligned lines go through the span writers. They are clamped to the clip rect first, so the length can not overflow
+    if(y0 == y1)
+    {
+        //the left out last pixel is the left end if the line runs right to left
+        if(x0 > x1)
+        {
+            _swap_int(x0, x1);
+            x0 += skip;
+        }
+        else
+        {
+            x1 -= skip;
+        }
+        x0 = (x0 < minX) ? minX : x0;
+        x1 = (x1 > maxX) ? maxX : x1;
+        if(x0 <= x1)
+        {
+            gfx_write_span(gfx, x0, y0, (x1 - x0) + 1, color);
+        }
+        return;
+    }
+
+    if(x0 == x1)
+    {
+        if(y0 > y1)
+        {
+            _swap_int(y0, y1);
+            y0 += skip;
+        }
+        else
+        {
+            y1 -= skip;
+        }
+        y0 = (y0 < minY) ? minY : y0;
+        y1 = (y1 > maxY) ? maxY : y1;
+        if(y0 <= y1)
+        {
+            gfx_write_vspan(gfx, x0, y0, (y1 - y0) + 1, color);
+        }
+        return;
+    }
+
+    //deltas of far apart endpoints do not fit in an int, so the setup is done in 64 bits
+    bool steep = llabs((int64_t)y1 - y0) > llabs((int64_t)x1 - x0);
+    if (steep) {
+        _swap_int(x0, y0);
+        _swap_int(x1, y1);
+        _swap_int(minX, minY);
+        _swap_int(maxX, maxY);
+    }
+
+    bool reversed = (x0 > x1);
+    if (reversed) {
+        _swap_int(x0, x1);
+        _swap_int(y0, y1);
+    }
+
+    //dx and dy are below 2^32 and dy <= dx, so with the minor axis offset limited to dy every product below is under
+    //2^64, and is done in unsigned 64 bit math
+    int64_t dx = (int64_t)x1 - x0;
+    int64_t dy = llabs((int64_t)y1 - y0);
+    int64_t half = dx / 2;
+    int ystep = (y0 < y1) ? 1 : -1;
+    int64_t iStart, iEnd;   //range of steps that land in the clip rect
+    int64_t kLo, kHi;       //range of minor axis offsets that land in the clip rect
+
+    //After i steps the minor axis has moved k(i) = max(0, ceil((i*dy - dx/2) / dx)) times, so the visible range of
+    //steps can be solved for directly from the clip bounds
+    iStart = (minX > x0) ? ((int64_t)minX - x0) : 0;
+    iEnd = (maxX < x1) ? ((int64_t)maxX - x0) : dx;
+
+    //the last pixel is the first step if the line was reversed
+    if(!lastPixel && reversed)
+    {
+        iStart = (iStart < 1) ? 1 : iStart;
+    }
+    else if(!lastPixel)
+    {
+        iEnd = (iEnd > dx - 1) ? (dx - 1) : iEnd;
+    }
+
+    if(ystep > 0)
+    {
+        kLo = (int64_t)minY - y0;
+        kHi = (int64_t)maxY - y0;
+    }
+    else
+    {
+        kLo = (int64_t)y0 - maxY;
+        kHi = (int64_t)y0 - minY;
+    }
+
+    if((kHi < 0) || (kLo > dy))
+    {
+        return;
+    }
+
+    kHi = (kHi > dy) ? dy : kHi;
+
+    if(kLo > 0)
+    {
+        int64_t first = (int64_t)(((uint64_t)half + ((uint64_t)(kLo - 1) * (uint64_t)dx)) / (uint64_t)dy) + 1;
+        iStart = (first > iStart) ? first : iStart;
+    }
+
+    int64_t last = (int64_t)(((uint64_t)half + ((uint64_t)kHi * (uint64_t)dx)) / (uint64_t)dy);
+    iEnd = (last < iEnd) ? last : iEnd;
+
+    if(iStart > iEnd)
+    {
+        return;
+    }
+
+    //Jump straight to the first visible step. The error term is in [0, dx), so the wrapping sum is exact
+    uint64_t moved = (uint64_t)iStart * (uint64_t)dy;
+    uint64_t k = (moved > (uint64_t)half) ? ((moved - (uint64_t)half + (uint64_t)dx - 1) / (uint64_t)dx) : 0;
+    int64_t err = (int64_t)((uint64_t)half - moved + (k * (uint64_t)dx));
+    int x = (int)(x0 + iStart);
+    int y = (int)(y0 + (ystep * (int64_t)k));
+    int count = (int)(iEnd - iStart) + 1;
+
+    if(steep)
+    {
+        while(count--)
+        {
+            gfx->fPlot(gfx, y, x, color);
+            err -= dy;
+            if (err < 0) {
+                y += ystep;
+                err += dx;
+            }
+            x++;
+        }
+    }
+    else
+    {
+        //shallow lines are a series of horizontal runs
+        int runStart = x;
+        while(count--)
+        {
+            err -= dy;
+            if((err < 0) || (count == 0))
+            {
+                gfx->fSpan(gfx, runStart, y, (x - runStart) + 1, color);
+                runStart = x + 1;
+            }
+
+            if (err < 0) {
+                y += ystep;
+                err += dx;
+            }
+            x++;
+        }
+    }
+}
+
+/**
+ * @brief fills a rectangle with a given span writer. Clips once, and collapses full width rectangles into a single run
+ *        when the writer stores colors as is
+ */
+static void gfx_fill_rect_span(gfx_t* gfx, f_gfx_span span, int x, int y, int w, int h, uint32_t color)
+{
+    if(!gfx_clip_rect(gfx, &x, &y, &w, &h))
+    {
+        return;
+    }
+
+    //Full width rows are contiguous in the buffer regardless of flips, so write them as one run
+    if((span != &gfx_span_cb) && (span == gfx_plain_span(gfx)) && (w == gfx->mWidth))
+    {
+        int top = (gfx->mYStep > 0) ? y : (y + h - 1);
+        gfx_fill_run(gfx, GFX_PIXEL_INDEX(gfx, (gfx->mXStep > 0) ? 0 : (w - 1), top), w * h, color);
+        return;
+    }
+
+    for(int i=0; i < h; i++)
+    {
+        span(gfx, x, y + i, w, color);
+    }
+}
+
+/**
+ * @brief fills a rectangle with a color, using the pen writers
+ */
+static void gfx_fill_rect(gfx_t* gfx, int x, int y, int w, int h, uint32_t color)
+{
+    gfx_fill_rect_span(gfx, gfx->fSpan, x, y, w, h, color);
+}
+
+/**
+ * @brief integer square root (floor)
+ */
+static uint64_t gfx_isqrt(uint64_t val)
+{
+    uint64_t res = 0;
+    uint64_t bit = (uint64_t)1 << 62;
+
+    while(bit > val)
+    {
+        bit >>= 2;
+    }
+
+    while(bit)
+    {
+        if(val >= res + bit)
+        {
+            val -= res + bit;
+            res = (res >> 1) + bit;
+        }
+        else
+        {
+            res >>= 1;
+        }
+        bit >>= 2;
+    }
+
+    return res;
+}
+
+/**
+ * @brief scan converts a convex polygon into spans
+ * @note vertices are 16.16 fixed point. A pixel is filled if its center lies inside the polygon
+ * @param gfx ptr to gfx canvas
+ * @param px x coords of vertices
+ * @param py y coords of vertices
+ * @param count number of vertices
+ * @param color packed color to write
+ */
+static void gfx_fill_convex(gfx_t* gfx, const int32_t* px, const int32_t* py, int count, uint32_t color)
+{
+    int32_t minY = py[0];
+    int32_t maxY = py[0];
+    int i;
+
+    for(i=1; i < count; i++)
+    {
+        minY = (py[i] < minY) ? py[i] : minY;
+        maxY = (py[i] > maxY) ? py[i] : maxY;
+    }
+
+    //first and last rows whose pixel centers are inside
+    int yStart = (minY - 0x8000 + 0xFFFF) >> 16;
+    int yEnd = ((maxY - 0x8000 + 0xFFFF) >> 16) - 1;
+
+    yStart = (yStart < gfx->mClip.mY) ? gfx->mClip.mY : yStart;
+    yEnd = (yEnd >= GFX_CLIP_Y1(gfx)) ? (GFX_CLIP_Y1(gfx) - 1) : yEnd;
+
+    for(int y = yStart; y <= yEnd; y++)
+    {
+        int32_t yc = (y << 16) + 0x8000;
+        int32_t left = INT32_MAX;
+        int32_t right = INT32_MIN;
+
+        for(i=0; i < count; i++)
+        {
+            int32_t xa = px[i];
+            int32_t ya = py[i];
+            int32_t xb = px[(i + 1) % count];
+            int32_t yb = py[(i + 1) % count];
+
+            //half open on y so shared vertices are only counted once
+            if(((yc >= ya) && (yc < yb)) || ((yc >= yb) && (yc < ya)))
+            {
+                int32_t xi = xa + (int32_t)(((int64_t)(yc - ya) * (xb - xa)) / (yb - ya));
+                left = (xi < left) ? xi : left;
+                right = (xi > right) ? xi : right;
+            }
+        }
+
+        if(right > left)
+        {
+            int x0 = (left - 0x8000 + 0xFFFF) >> 16;
+            int x1 = (right - 0x8000 + 0xFFFF) >> 16;
+            gfx_write_span(gfx, x0, y, x1 - x0, color);
+        }
+    }
+}
+
+#define GFX_OUT_LEFT   0x01
+#define GFX_OUT_RIGHT  0x02
+#define GFX_OUT_TOP    0x04
+#define GFX_OUT_BOTTOM 0x08
+
+/**
+ * @brief gets which sides of a rect (x0,y0)-(x1,y1) a point is outside of
+ */
+static inline int gfx_outcode(int64_t x, int64_t y, const int64_t* rect)
+{
+    return ((x < rect[0]) ? GFX_OUT_LEFT : 0) | ((x > rect[2]) ? GFX_OUT_RIGHT : 0) |
+           ((y < rect[1]) ? GFX_OUT_TOP : 0) | ((y > rect[3]) ? GFX_OUT_BOTTOM : 0);
+}
+
+/**
+ * @brief clips a segment to a rect (Cohen-Sutherland). Crossing points are found by bisection, so there are no
+ *        products that could overflow, and clipped ends stay on the line (to 1 unit)
+ * @param a,b segment ends as {x, y}, moved onto the rect
+ * @param rect x0, y0, x1, y1 (inclusive)
+ * @return false if the segment does not touch the rect
+ */
+static bool gfx_clip_segment(int64_t* a, int64_t* b, const int64_t* rect)
+{
+    int codeA = gfx_outcode(a[0], a[1], rect);
+    int codeB = gfx_outcode(b[0], b[1], rect);
+
+    while(codeA | codeB)
+    {
+        if(codeA & codeB)
+        {
+            return false;
+        }
+
+        //move an outside end to where the segment crosses one of the sides it is outside of
+        int64_t* out = codeA ? a : b;
+        int64_t* in = codeA ? b : a;
+        int code = codeA ? codeA : codeB;
+        int side = code & -code;    //lowest set bit, one side at a time
+        int axis = (side & (GFX_OUT_LEFT | GFX_OUT_RIGHT)) ? 0 : 1;
+        int64_t edge = (side & (GFX_OUT_LEFT | GFX_OUT_TOP)) ? rect[axis] : rect[axis + 2];
+        bool below = (out[axis] < edge);
+        int64_t lo[2] = { out[0], out[1] };
+        int64_t hi[2] = { in[0], in[1] };
+
+        while((llabs(hi[0] - lo[0]) > 1) || (llabs(hi[1] - lo[1]) > 1))
+        {
+            int64_t mid[2] = { lo[0] + ((hi[0] - lo[0]) / 2), lo[1] + ((hi[1] - lo[1]) / 2) };
+
+            if((mid[axis] < edge) == below)
+            {
+                lo[0] = mid[0];
+                lo[1] = mid[1];
+            }
+            else
+            {
+                hi[0] = mid[0];
+                hi[1] = mid[1];
+            }
+        }
+
+        out[0] = hi[0];
+        out[1] = hi[1];
+
+        if(codeA)
+        {
+            codeA = gfx_outcode(a[0], a[1], rect);
+        }
+        else
+        {
+            codeB = gfx_outcode(b[0], b[1], rect);
+        }
+    }
+
+    return true;
+}
+
+/**
+ * @brief gets the half stroke normal of a line
+ * @param dx,dy direction of the line. Only the direction matters, so long lines are scaled down (to at most 0x8000)
+ *        to keep the squares in range
+ * @param nx,ny normal in 16.16, half the stroke long
+ */
+static void gfx_stroke_normal(int64_t* dx, int64_t* dy, int stroke, int32_t* nx, int32_t* ny)
+{
+    while((llabs(*dx) > 0x8000) || (llabs(*dy) > 0x8000))
+    {
+        *dx /= 2;
+        *dy /= 2;
+    }
+
+    int64_t len = (int64_t)gfx_isqrt((uint64_t)((*dx * *dx) + (*dy * *dy)) << 32); //length in 16.16
+
+    *nx = (int32_t)((-*dy * stroke * ((int64_t)1 << 31)) / len);
+    *ny = (int32_t)((*dx * stroke * ((int64_t)1 << 31)) / len);
+}
+
+/**
+ * @brief draws a line of any stroke width. Wide lines are scan converted as a single quad with butt ends
+ * @note the line is clipped to the clip rect (grown by the stroke) first, so far off canvas ends stay in range
+ */
+static void gfx_stroke_line(gfx_t* gfx, int x0, int y0, int x1, int y1, int stroke, uint32_t color)
+{
+    if(stroke <= 1)
+    {
+        gfx_write_line(gfx, x0, y0, x1, y1, true, color);
+        return;
+    }
+
+    //Axis aligned wide lines are just rectangles. Their length is limited to the clip rect so it can not overflow
+    if((y0 == y1) || (x0 == x1))
+    {
+        int minX = (x0 < x1) ? x0 : x1;
+        int maxX = (x0 < x1) ? x1 : x0;
+        int minY = (y0 < y1) ? y0 : y1;
+        int maxY = (y0 < y1) ? y1 : y0;
+
+        minX = (minX < gfx->mClip.mX - stroke) ? (gfx->mClip.mX - stroke) : minX;
+        maxX = (maxX > GFX_CLIP_X1(gfx) + stroke) ? (GFX_CLIP_X1(gfx) + stroke) : maxX;
+        minY = (minY < gfx->mClip.mY - stroke) ? (gfx->mClip.mY - stroke) : minY;
+        maxY = (maxY > GFX_CLIP_Y1(gfx) + stroke) ? (GFX_CLIP_Y1(gfx) + stroke) : maxY;
+
+        if((minX > maxX) || (minY > maxY))
+        {
+            return;
+        }
+
+        if(y0 == y1)
+        {
+            gfx_fill_rect(gfx, minX, y0 - (stroke / 2), (maxX - minX) + 1, stroke, color);
+        }
+        else
+        {
+            gfx_fill_rect(gfx, x0 - (stroke / 2), minY, stroke, (maxY - minY) + 1, color);
+        }
+        return;
+    }
+
+    int64_t dx = (int64_t)x1 - x0;
+    int64_t dy = (int64_t)y1 - y0;
+    int32_t nx, ny;
+
+    gfx_stroke_normal(&dx, &dy, stroke, &nx, &ny);
+
+    //endpoints are pixel centers. Far ends are clipped to where the quad can still touch the clip rect
+    int64_t a[2] = { ((int64_t)x0 * 65536) + 0x8000, ((int64_t)y0 * 65536) + 0x8000 };
+    int64_t b[2] = { ((int64_t)x1 * 65536) + 0x8000, ((int64_t)y1 * 65536) + 0x8000 };
+    int64_t rect[4] = { (int64_t)(gfx->mClip.mX - stroke) * 65536, (int64_t)(gfx->mClip.mY - stroke) * 65536,
+                        (int64_t)(GFX_CLIP_X1(gfx) + stroke) * 65536, (int64_t)(GFX_CLIP_Y1(gfx) + stroke) * 65536 };
+
+    //lines that fit in 16.16 are not clipped, so clipping can not move their edges by rounding
+    bool far = (llabs(a[0]) > 0x3FFF0000) || (llabs(a[1]) > 0x3FFF0000) || (llabs(b[0]) > 0x3FFF0000) || (llabs(b[1]) > 0x3FFF0000);
+
+    if(far && !gfx_clip_segment(a, b, rect))
+    {
+        return;
+    }
+
+    int32_t px[4] = { (int32_t)a[0] + nx, (int32_t)b[0] + nx, (int32_t)b[0] - nx, (int32_t)a[0] - nx };
+    int32_t py[4] = { (int32_t)a[1] + ny, (int32_t)b[1] + ny, (int32_t)b[1] - ny, (int32_t)a[1] - ny };
+
+    gfx_fill_convex(gfx, px, py, 4, color);
+}
+
+/**
+ * @brief polygon edge, for the scanline fill
+ */
+typedef struct{
+    int64_t x;              //x at the current scanline (16.16)
+    int64_t slope;          //change in x per scanline (16.16)
+    int yTop;               //first scanline the edge is active on
+    int yBottom;            //scanline after the last one the edge is active on
+    int8_t dir;             //winding direction (+1 down, -1 up)
+} gfx_edge_t;
+
+/**
+ * @brief edge table of a scanline fill. Tables of up to GFX_SCAN_STACK_EDGES edges use the arrays in the struct, so
+ *        small polygons do not allocate
+ */
+typedef struct{
+    gfx_edge_t* mEdges;
+    gfx_edge_t** mActive;
+    int mCount;
+    gfx_edge_t mStackEdges[GFX_SCAN_STACK_EDGES];
+    gfx_edge_t* mStackActive[GFX_SCAN_STACK_EDGES];
+} gfx_edge_table_t;
+
+static int gfx_edge_compare(const void* a, const void* b)
+{
+    return ((const gfx_edge_t*)a)->yTop - ((const gfx_edge_t*)b)->yTop;
+}
+
+/**
+ * @brief sets up an edge table for up to maxEdges edges
+ */
+static mrt_status_t gfx_edge_table_init(gfx_edge_table_t* table, int maxEdges)
+{
+    table->mCount = 0;
+    table->mEdges = table->mStackEdges;
+    table->mActive = table->mStackActive;
+
+    if(maxEdges <= GFX_SCAN_STACK_EDGES)
+    {
+        return MRT_STATUS_OK;
+    }
+
+    table->mEdges = (gfx_edge_t*) malloc(maxEdges * sizeof(gfx_edge_t));
+    table->mActive = (gfx_edge_t**) malloc(maxEdges * sizeof(gfx_edge_t*));
+    if((table->mEdges == NULL) || (table->mActive == NULL))
+    {
+        free(table->mEdges);
+        free(table->mActive);
+        return MRT_STATUS_ERROR;
+    }
+
+    return MRT_STATUS_OK;
+}
+
+static void gfx_edge_table_deinit(gfx_edge_table_t* table)
+{
+    if(table->mEdges != table->mStackEdges)
+    {
+        free(table->mEdges);
+        free(table->mActive);
+    }
+}
+
+/**
+ * @brief adds an edge to an edge table. Edges that do not cross a scanline center (such as horizontal ones) are dropped
+ * @note points are 16.16 fixed point, and should be within +/-2^23 pixels so the slope can not overflow
+ */
+static void gfx_edge_table_add(gfx_edge_table_t* table, int64_t x0, int64_t y0, int64_t x1, int64_t y1)
+{
+    gfx_edge_t* edge = &table->mEdges[table->mCount];
+    int8_t dir = (y1 > y0) ? 1 : -1;
+
+    if(dir < 0)
+    {
+        int64_t tmp = x0;
+        x0 = x1;
+        x1 = tmp;
+        tmp = y0;
+        y0 = y1;
+        y1 = tmp;
+    }
+
+    //active on the scanlines whose centers are in [y0, y1)
+    edge->yTop = (int)((y0 - 0x8000 + 0xFFFF) >> 16);
+    edge->yBottom = (int)((y1 - 0x8000 + 0xFFFF) >> 16);
+    if(edge->yTop >= edge->yBottom)
+    {
+        return;
+    }
+
+    edge->dir = dir;
+    edge->slope = ((x1 - x0) * 65536) / (y1 - y0);
+    edge->x = x0 + (((((int64_t)edge->yTop * 65536) + 0x8000 - y0) * (x1 - x0)) / (y1 - y0));
+    table->mCount++;
+}
+
+/**
+ * @brief adds a closed contour to an edge table
+ */
+static void gfx_edge_table_add_contour(gfx_edge_table_t* table, const int64_t* px, const int64_t* py, int count)
+{
+    for(int i=0; i < count; i++)
+    {
+        gfx_edge_table_add(table, px[i], py[i], px[(i + 1) % count], py[(i + 1) % count]);
+    }
+}
+
+/**
+ * @brief scanline fill of an edge table using an active edge list. A pixel is filled if its center is inside
+ * @param nonzero true for the nonzero winding rule, false for even-odd
+ */
+static void gfx_edge_table_fill(gfx_t* gfx, gfx_edge_table_t* table, bool nonzero, uint32_t color)
+{
+    gfx_edge_t* edges = table->mEdges;
+    gfx_edge_t** active = table->mActive;
+    int edgeCount = table->mCount;
+    int activeCount = 0;
+    int next = 0;
+    int i, a;
+    int minY = INT_MAX;
+    int maxY = INT_MIN;
+
+    for(i=0; i < edgeCount; i++)
+    {
+        minY = (edges[i].yTop < minY) ? edges[i].yTop : minY;
+        maxY = (edges[i].yBottom > maxY) ? edges[i].yBottom : maxY;
+    }
+
+    qsort(edges, edgeCount, sizeof(gfx_edge_t), gfx_edge_compare);
+
+    int yStart = (minY < gfx->mClip.mY) ? gfx->mClip.mY : minY;
+    int yEnd = (maxY > GFX_CLIP_Y1(gfx)) ? GFX_CLIP_Y1(gfx) : maxY;
+
+    for(int y = yStart; y < yEnd; y++)
+    {
+        //drop finished edges
+        for(i=0, a=0; i < activeCount; i++)
+        {
+            if(active[i]->yBottom > y)
+            {
+                active[a++] = active[i];
+            }
+        }
+        activeCount = a;
+
+        //add edges starting on this scanline (or above it, if the top was clipped)
+        while((next < edgeCount) && (edges[next].yTop <= y))
+        {
+            gfx_edge_t* edge = &edges[next++];
+            if(edge->yBottom > y)
+            {
+                edge->x += edge->slope * (y - edge->yTop);
+                active[activeCount++] = edge;
+            }
+        }
+
+        //keep the list sorted by x. It is nearly sorted from the last scanline, so insertion sort is cheap
+        for(i=1; i < activeCount; i++)
+        {
+            gfx_edge_t* edge = active[i];
+            for(a = i; (a > 0) && (active[a - 1]->x > edge->x); a--)
+            {
+                active[a] = active[a - 1];
+            }
+            active[a] = edge;
+        }
+
+        //fill between edges where the rule says we are inside
+        int winding = 0;
+        for(i=0; i < activeCount; i++)
+        {
+            int prev = winding;
+            winding = (nonzero) ? (winding + active[i]->dir) : (winding ^ 1);
+
+            if((prev == 0) && (winding != 0) && (i + 1 < activeCount))
+            {
+                //find where this inside run ends
+                int end = i + 1;
+                int w = winding;
+                while(end < activeCount)
+                {
+                    w = (nonzero) ? (w + active[end]->dir) : (w ^ 1);
+                    if(w == 0)
+                    {
+                        break;
+                    }
+                    end++;
+                }
+
+                if(end >= activeCount)
+                {
+                    break;
+                }
+
+                //first pixel centers at or right of each edge, limited to the clip rect so they fit an int
+                int64_t x0 = (active[i]->x - 0x8000 + 0xFFFF) >> 16;
+                int64_t x1 = (active[end]->x - 0x8000 + 0xFFFF) >> 16;
+                x0 = (x0 < gfx->mClip.mX) ? gfx->mClip.mX : x0;
+                x1 = (x1 > GFX_CLIP_X1(gfx)) ? GFX_CLIP_X1(gfx) : x1;
+                if(x1 > x0)
+                {
+                    gfx_write_span(gfx, (int)x0, y, (int)(x1 - x0), color);
+                }
+
+                i = end;
+                winding = 0;
+            }
+        }
+
+        for(i=0; i < activeCount; i++)
+        {
+            active[i]->x += active[i]->slope;
+        }
+    }
+}
+
+/**
+ * @brief scanline polygon fill. Vertices are pixel centers
+ * @param nonzero true for the nonzero winding rule, false for even-odd
+ */
+static mrt_status_t gfx_scan_polygon(gfx_t* gfx, const gfx_point_t* points, int count, bool nonzero, uint32_t color)
+{
+    gfx_edge_table_t table;
+
+    if(count < 3)
+    {
+        return MRT_STATUS_OK;
+    }
+
+    if(gfx_edge_table_init(&table, count) != MRT_STATUS_OK)
+    {
+        return MRT_STATUS_ERROR;
+    }
+
+    for(int i=0; i < count; i++)
+    {
+        const gfx_point_t* p0 = &points[i];
+        const gfx_point_t* p1 = &points[(i + 1) % count];
+
+        gfx_edge_table_add(&table, ((int64_t)p0->mX * 65536) + 0x8000, ((int64_t)p0->mY * 65536) + 0x8000,
+                           ((int64_t)p1->mX * 65536) + 0x8000, ((int64_t)p1->mY * 65536) + 0x8000);
+    }
+
+    gfx_edge_table_fill(gfx, &table, nonzero, color);
+    gfx_edge_table_deinit(&table);
+    return MRT_STATUS_OK;
+}
+
+/**
+ * @brief adds the bevel join at a corner between two wide sides
+ * @note the join is the rectangle spanned by both normals. Outside of the sides it only covers the bevel, and it has the
+ *       corner strictly inside, so rounding on the edges that meet there can not leave a hole
+ * @param x,y corner (16.16)
+ * @param dx0,dy0,nx0,ny0 scaled direction and half stroke normal of the side into the corner
+ * @param dx1,dy1,nx1,ny1 scaled direction and half stroke normal of the side out of the corner
+ */
+static void gfx_edge_table_add_join(gfx_edge_table_t* table, int64_t x, int64_t y, int64_t dx0, int64_t dy0, int32_t nx0,
+                                    int32_t ny0, int64_t dx1, int64_t dy1, int32_t nx1, int32_t ny1)
+{
+    int64_t turn = (dx0 * dy1) - (dy0 * dx1);
+
+    if(turn == 0)
+    {
+        return;
+    }
+
+    //wound the same way as the side quads, so the nonzero rule fills their union
+    int a = (turn > 0) ? 1 : 0;
+    int64_t px[4];
+    int64_t py[4];
+
+    px[a] = x + nx0;
+    py[a] = y + ny0;
+    px[1 - a] = x + nx1;
+    py[1 - a] = y + ny1;
+    px[2 + a] = x - nx0;
+    py[2 + a] = y - ny0;
+    px[3 - a] = x - nx1;
+    py[3 - a] = y - ny1;
+
+    gfx_edge_table_add_contour(table, px, py, 4);
+}
+
+/**
+ * @brief draws a closed outline wider than one pixel as a single fill of a quad for each side and a bevel at each
+ *        corner, so pixels where the sides meet are only written once
+ */
+static mrt_status_t gfx_stroke_polygon(gfx_t* gfx, const gfx_point_t* points, int count, int stroke, uint32_t color)
+{
+    gfx_edge_table_t table;
+    bool started = false;
+    int64_t firstX = 0, firstY = 0, firstDx = 0, firstDy = 0;
+    int32_t firstNx = 0, firstNy = 0;
+    int64_t prevDx = 0, prevDy = 0;
+    int32_t prevNx = 0, prevNy = 0;
+
+    if(gfx_edge_table_init(&table, count * 8) != MRT_STATUS_OK)
+    {
+        return MRT_STATUS_ERROR;
+    }
+
+    for(int i=0; i < count; i++)
+    {
+        const gfx_point_t* p0 = &points[i];
+        const gfx_point_t* p1 = &points[(i + 1) % count];
+        int64_t dx = (int64_t)p1->mX - p0->mX;
+        int64_t dy = (int64_t)p1->mY - p0->mY;
+        int32_t nx, ny;
+
+        if((dx == 0) && (dy == 0))
+        {
+            continue;
+        }
+
+        gfx_stroke_normal(&dx, &dy, stroke, &nx, &ny);
+
+        int64_t ax = ((int64_t)p0->mX * 65536) + 0x8000;
+        int64_t ay = ((int64_t)p0->mY * 65536) + 0x8000;
+        int64_t bx = ((int64_t)p1->mX * 65536) + 0x8000;
+        int64_t by = ((int64_t)p1->mY * 65536) + 0x8000;
+        int64_t px[4] = { ax + nx, bx + nx, bx - nx, ax - nx };
+        int64_t py[4] = { ay + ny, by + ny, by - ny, ay - ny };
+
+        gfx_edge_table_add_contour(&table, px, py, 4);
+
+        if(started)
+        {
+            gfx_edge_table_add_join(&table, ax, ay, prevDx, prevDy, prevNx, prevNy, dx, dy, nx, ny);
+        }
+        else
+        {
+            started = true;
+            firstX = ax;
+            firstY = ay;
+            firstDx = dx;
+            firstDy = dy;
+            firstNx = nx;
+            firstNy = ny;
+        }
+
+        prevDx = dx;
+        prevDy = dy;
+        prevNx = nx;
+        prevNy = ny;
+    }
+
+    if(started)
+    {
+        gfx_edge_table_add_join(&table, firstX, firstY, prevDx, prevDy, prevNx, prevNy, firstDx, firstDy, firstNx, firstNy);
+    }
+
+    gfx_edge_table_fill(gfx, &table, true, color);
+    gfx_edge_table_deinit(&table);
+    return MRT_STATUS_OK;
+}
+
+/**
+ * @brief angular sector used to limit arcs. Split into at most two sub-sectors of 180 degrees or less
+ * @note directions are Q14 unit vectors. Angles are in degrees, clockwise from 3 o'clock on the canvas
+ */
+typedef struct{
+    int count;              //number of sub-sectors (0 = full circle)
+    int32_t start[2][2];    //start direction of each sub-sector
+    int32_t end[2][2];      //end direction of each sub-sector
+} gfx_sector_t;
+
+/**
+ * @brief sine of an angle in degrees, Q14 fixed point
+ */
+static int32_t gfx_sin_q14(int deg)
+{
+    deg %= 360;
+    if(deg < 0)
+    {
+        deg += 360;
+    }
+
+    if(deg <= 90)
+    {
+        return gfx_sin_table[deg];
+    }
+    else if(deg <= 180)
+    {
+        return gfx_sin_table[180 - deg];
+    }
+    else if(deg <= 270)
+    {
+        return -gfx_sin_table[deg - 180];
+    }
+
+    return -gfx_sin_table[360 - deg];
+}
+
+/**
+ * @brief builds a sector from start and end angles
+ */
+static void gfx_sector_init(gfx_sector_t* sector, int start, int end)
+{
+    int sweep = end - start;
+
+    if(sweep >= 360 || sweep <= -360)
+    {
+        sector->count = 0;
+        return;
+    }
+
+    sweep %= 360;
+    if(sweep <= 0)
+    {
+        sweep += 360;
+    }
+
+    //sectors wider than 180 are split so each half can be tested with two half-planes
+    int mid = (sweep > 180) ? (start + 180) : (start + sweep);
+    sector->count = 1;
+    sector->start[0][0] = gfx_sin_q14(start + 90);
+    sector->start[0][1] = gfx_sin_q14(start);
+    sector->end[0][0] = gfx_sin_q14(mid + 90);
+    sector->end[0][1] = gfx_sin_q14(mid);
+
+    if(sweep > 180)
+    {
+        sector->count = 2;
+        sector->start[1][0] = sector->end[0][0];
+        sector->start[1][1] = sector->end[0][1];
+        sector->end[1][0] = gfx_sin_q14(start + sweep + 90);
+        sector->end[1][1] = gfx_sin_q14(start + sweep);
+    }
+}
+
+/**
+ * @brief checks if a point (relative to center) is inside a sector
+ */
+static bool gfx_sector_contains(const gfx_sector_t* sector, int x, int y)
+{
+    if(sector->count == 0)
+    {
+        return true;
+    }
+
+    for(int i=0; i < sector->count; i++)
+    {
+        const int32_t* a = sector->start[i];
+        const int32_t* b = sector->end[i];
+
+        if((((int64_t)a[0] * y) - ((int64_t)a[1] * x) >= 0) && (((int64_t)x * b[1]) - ((int64_t)y * b[0]) >= 0))
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/**
+ * @brief narrows [lo,hi] to the x values satisfying k*x >= m
+ */
+static inline void gfx_constrain(int64_t k, int64_t m, int* lo, int* hi)
+{
+    if(k > 0)
+    {
+        int64_t v = (m >= 0) ? ((m + k - 1) / k) : -((-m) / k);   //ceil(m/k)
+        *lo = (v > *lo) ? (int)v : *lo;
+    }
+    else if(k < 0)
+    {
+        k = -k;
+        m = -m;
+        int64_t v = (m >= 0) ? (m / k) : -(((-m) + k - 1) / k);   //floor(m/k) with the sign flipped
+        *hi = (v < *hi) ? (int)v : *hi;
+    }
+    else if(m > 0)
+    {
+        *lo = 1;
+        *hi = 0;
+    }
+}
+
+/**
+ * @brief draws the part of a horizontal run (relative to center) that is inside a sector
+ * @param x0 first x of run (relative)
+ * @param x1 last x of run (relative)
+ * @param dy row (relative)
+ */
+static void gfx_sector_span(gfx_t* gfx, int cx, int cy, int x0, int x1, int dy, const gfx_sector_t* sector, uint32_t color)
+{
+    int lo[2];
+    int hi[2];
+    int i;
+
+    if(sector == NULL || sector->count == 0)
+    {
+        gfx_write_span(gfx, cx + x0, cy + dy, (x1 - x0) + 1, color);
+        return;
+    }
+
+    //each sub-sector is the intersection of two half-planes, which cut a row down to a single interval
+    for(i=0; i < sector->count; i++)
+    {
+        lo[i] = x0;
+        hi[i] = x1;
+        gfx_constrain(-sector->start[i][1], -(int64_t)sector->start[i][0] * dy, &lo[i], &hi[i]);
+        gfx_constrain(sector->end[i][1], (int64_t)sector->end[i][0] * dy, &lo[i], &hi[i]);
+    }
+
+    //merge the intervals if they touch so no pixel is written twice
+    if((sector->count == 2) && (lo[0] <= hi[0]) && (lo[1] <= hi[1]) && (lo[1] <= hi[0] + 1) && (lo[0] <= hi[1] + 1))
+    {
+        lo[0] = (lo[1] < lo[0]) ? lo[1] : lo[0];
+        hi[0] = (hi[1] > hi[0]) ? hi[1] : hi[0];
+        lo[1] = 1;
+        hi[1] = 0;
+    }
+
+    for(i=0; i < sector->count; i++)
+    {
+        if(lo[i] <= hi[i])
+        {
+            gfx_write_span(gfx, cx + lo[i], cy + dy, (hi[i] - lo[i]) + 1, color);
+        }
+    }
+}
+
+/**
+ * @brief fills an elliptical band row by row. Each row is written once, as one or two spans
+ * @note a pixel is inside an ellipse if x^2*ry^2 + y^2*rx^2 <= rx^2*ry^2 + rx*ry*(rx+ry)/2 (for a circle, x^2 + y^2 <= r^2 + r)
+ * @param rx outer x radius
+ * @param ry outer y radius
+ * @param stroke width of band measured inward, 0 for solid
+ * @param sector sector to limit drawing to, NULL for all
+ */
+static void gfx_fill_ellipse_band(gfx_t* gfx, int cx, int cy, int rx, int ry, int stroke, const gfx_sector_t* sector, uint32_t color)
+{
+    int ix = rx - stroke;
+    int iy = ry - stroke;
+    bool hollow = (stroke > 0) && (ix >= 0) && (iy >= 0);
+
+    int64_t orx2 = (int64_t)rx * rx;
+    int64_t ory2 = (int64_t)ry * ry;
+    int64_t olimit = (orx2 * ory2) + (((int64_t)rx * ry * (rx + ry)) / 2);
+    int64_t irx2 = (int64_t)ix * ix;
+    int64_t iry2 = (int64_t)iy * iy;
+    int64_t ilimit = (irx2 * iry2) + (((int64_t)ix * iy * (ix + iy)) / 2);
+
+    int xo = rx;
+    int xi = ix;
+
+    for(int dy = 0; dy <= ry; dy++)
+    {
+        //half widths only shrink as we move away from the center, so step them down
+        while((xo > 0) && ((((int64_t)xo * xo) * ory2) + (((int64_t)dy * dy) * orx2) > olimit))
+        {
+            xo--;
+        }
+
+        bool inner = hollow && (dy <= iy);
+        if(inner)
+        {
+            while((xi >= 0) && ((((int64_t)xi * xi) * iry2) + (((int64_t)dy * dy) * irx2) > ilimit))
+            {
+                xi--;
+            }
+            inner = (xi >= 0);
+        }
+
+        for(int side = 0; side < ((dy == 0) ? 1 : 2); side++)
+        {
+            int row = (side == 0) ? dy : -dy;
+
+            if((cy + row < gfx->mClip.mY) || (cy + row >= GFX_CLIP_Y1(gfx)))
+            {
+                continue;
+            }
+
+            if(inner)
+            {
+                gfx_sector_span(gfx, cx, cy, -xo, -xi - 1, row, sector, color);
+                gfx_sector_span(gfx, cx, cy, xi + 1, xo, row, sector, color);
+            }
+            else
+            {
+                gfx_sector_span(gfx, cx, cy, -xo, xo, row, sector, color);
+            }
+        }
+    }
+}
+
+/**
+ * @brief plots the up to 8 symmetric points of a circle octant point, without repeating points on the axes or diagonals
+ */
+static void gfx_plot_octants(gfx_t* gfx, int cx, int cy, int x, int y, const gfx_sector_t* sector, uint32_t color)
+{
+    int pts[8][2] = {
+        { x,  y}, {-x,  y}, { x, -y}, {-x, -y},
+        { y,  x}, {-y,  x}, { y, -x}, {-y, -x}
+    };
+    int count = (x == y) ? 4 : 8;
+
+    if(x == 0)
+    {
+        count = 1;
+    }
+
+    for(int i=0; i < count; i++)
+    {
+        //on the axes the mirrored points land on top of each other
+        if((y == 0) && ((i == 2) || (i == 3) || (i == 5) || (i == 7)))
+        {
+            continue;
+        }
+
+        if((sector == NULL) || gfx_sector_contains(sector, pts[i][0], pts[i][1]))
+        {
+            gfx_plot_clipped(gfx, cx + pts[i][0], cy + pts[i][1], color);
+        }
+    }
+}
+
+/**
+ * @brief midpoint circle outline, one pixel wide
+ */
+static void gfx_circle_outline(gfx_t* gfx, int cx, int cy, int r, const gfx_sector_t* sector, uint32_t color)
+{
+    int x = r;
+    int y = 0;
+    int err = 1 - r;
+
+    while(x >= y)
+    {
+        gfx_plot_octants(gfx, cx, cy, x, y, sector, color);
+
+        y++;
+        if(err < 0)
+        {
+            err += (2 * y) + 1;
+        }
+        else
+        {
+            x--;
+            err += (2 * (y - x)) + 1;
+        }
+    }
+}
+
+/**
+ * @brief midpoint circle fill. Rows are emitted as spans as the octant walk finishes them, so each row is written once
+ */
+static void gfx_circle_fill(gfx_t* gfx, int cx, int cy, int r, uint32_t color)
+{
+    int x = r;
+    int y = 0;
+    int err = 1 - r;
+
+    while(x >= y)
+    {
+        //rows +-y are done as soon as they are visited
+        gfx_write_span(gfx, cx - x, cy + y, (2 * x) + 1, color);
+        if(y != 0)
+        {
+            gfx_write_span(gfx, cx - x, cy - y, (2 * x) + 1, color);
+        }
+
+        int nx = x;
+        int ny = y + 1;
+        if(err < 0)
+        {
+            err += (2 * ny) + 1;
+        }
+        else
+        {
+            nx = x - 1;
+            err += (2 * (ny - nx)) + 1;
+        }
+
+        //rows +-x are done when x is about to change, at their widest y
+        if((nx != x) && (x != y))
+        {
+            gfx_write_span(gfx, cx - y, cy + x, (2 * y) + 1, color);
+            gfx_write_span(gfx, cx - y, cy - x, (2 * y) + 1, color);
+        }
+
+        x = nx;
+        y = ny;
+    }
+}
+
+/**
+ * @brief plots the up to 4 symmetric points of an ellipse quadrant point, without repeating points on the axes
+ */
+static void gfx_plot_ellipse_points(gfx_t* gfx, int cx, int cy, int x, int y, uint32_t color)
+{
+    gfx_plot_clipped(gfx, cx + x, cy + y, color);
+    if(x != 0)
+    {
+        gfx_plot_clipped(gfx, cx - x, cy + y, color);
+    }
+
+    if(y != 0)
+    {
+        gfx_plot_clipped(gfx, cx + x, cy - y, color);
+        if(x != 0)
+        {
+            gfx_plot_clipped(gfx, cx - x, cy - y, color);
+        }
+    }
+}
+
+/**
+ * @brief midpoint ellipse. Outlines plot the 4 symmetric points, fills emit each row once at its widest point
+ */
+static void gfx_ellipse_midpoint(gfx_t* gfx, int cx, int cy, int rx, int ry, bool fill, uint32_t color)
+{
+    int64_t rx2 = (int64_t)rx * rx;
+    int64_t ry2 = (int64_t)ry * ry;
+    int64_t px = 0;
+    int64_t py = 2 * rx2 * ry;
+    int64_t p;
+    int x = 0;
+    int y = ry;
+
+    //region 1, x steps every iteration
+    p = ry2 - (rx2 * ry) + (rx2 / 4);
+    while(px < py)
+    {
+        int lastX = x;
+
+        if(!fill)
+        {
+            gfx_plot_ellipse_points(gfx, cx, cy, x, y, color);
+        }
+
+        x++;
+        px += 2 * ry2;
+        if(p < 0)
+        {
+            p += ry2 + px;
+        }
+        else
+        {
+            if(fill)
+            {
+                gfx_write_span(gfx, cx - lastX, cy + y, (2 * lastX) + 1, color);
+                gfx_write_span(gfx, cx - lastX, cy - y, (2 * lastX) + 1, color);
+            }
+            y--;
+            py -= 2 * rx2;
+            p += ry2 + px - py;
+        }
+    }
+
+    //region 2, y steps every iteration
+    p = (ry2 * (((int64_t)x * x) + x)) + (ry2 / 4) + (rx2 * ((int64_t)(y - 1) * (y - 1))) - (rx2 * ry2);
+    while(y >= 0)
+    {
+        if(fill)
+        {
+            gfx_write_span(gfx, cx - x, cy + y, (2 * x) + 1, color);
+            if(y != 0)
+            {
+                gfx_write_span(gfx, cx - x, cy - y, (2 * x) + 1, color);
+            }
+        }
+        else
+        {
+            gfx_plot_ellipse_points(gfx, cx, cy, x, y, color);
+        }
+
+        y--;
+        py -= 2 * rx2;
+        if(p > 0)
+        {
+            p += rx2 - py;
+        }
+        else
+        {
+            x++;
+            px += 2 * ry2;
+            p += rx2 - py + px;
+        }
+    }
+}
+
+/**
+ * @brief checks if a shape with radii rx,ry around a center can reach the canvas. Shapes that can not are skipped,
+ *        which also keeps center +- radius in int range for the rasterizers
+ */
+static inline bool gfx_radius_on_canvas(const gfx_t* gfx, int cx, int cy, int rx, int ry)
+{
+    return ((int64_t)cx + rx >= 0) && ((int64_t)cx - rx < gfx->mWidth) && ((int64_t)cy + ry >= 0) && ((int64_t)cy - ry < gfx->mHeight);
+}
+
+/**
+ * @brief area of a rect in pixels
+ */
+static inline uint32_t gfx_rect_area(const gfx_rect_t* rect)
+{
+    return (uint32_t)rect->mWidth * rect->mHeight;
+}
+
+/**
+ * @brief gets the bounding box of two rects
+ */
+static gfx_rect_t gfx_rect_union(const gfx_rect_t* a, const gfx_rect_t* b)
+{
+    gfx_rect_t ret;
+    int x1 = (a->mX + a->mWidth > b->mX + b->mWidth) ? (a->mX + a->mWidth) : (b->mX + b->mWidth);
+    int y1 = (a->mY + a->mHeight > b->mY + b->mHeight) ? (a->mY + a->mHeight) : (b->mY + b->mHeight);
+
+    ret.mX = (a->mX < b->mX) ? a->mX : b->mX;
+    ret.mY = (a->mY < b->mY) ? a->mY : b->mY;
+    ret.mWidth = x1 - ret.mX;
+    ret.mHeight = y1 - ret.mY;
+
+    return ret;
+}
+
+/**
+ * @brief gets the number of pixels covered by both rects
+ */
+static uint32_t gfx_rect_overlap(const gfx_rect_t* a, const gfx_rect_t* b)
+{
+    int x0 = (a->mX > b->mX) ? a->mX : b->mX;
+    int y0 = (a->mY > b->mY) ? a->mY : b->mY;
+    int x1 = (a->mX + a->mWidth < b->mX + b->mWidth) ? (a->mX + a->mWidth) : (b->mX + b->mWidth);
+    int y1 = (a->mY + a->mHeight < b->mY + b->mHeight) ? (a->mY + a->mHeight) : (b->mY + b->mHeight);
+
+    if((x1 <= x0) || (y1 <= y0))
+    {
+        return 0;
+    }
+
+    return (uint32_t)(x1 - x0) * (y1 - y0);
+}
+
+/**
+ * @brief gets the number of clean pixels that would be flushed if two dirty rects were merged
+ */
+static uint32_t gfx_rect_merge_cost(const gfx_rect_t* a, const gfx_rect_t* b)
+{
+    gfx_rect_t merged = gfx_rect_union(a, b);
+    return gfx_rect_area(&merged) + gfx_rect_overlap(a, b) - gfx_rect_area(a) - gfx_rect_area(b);
+}
+
+/**
+ * @brief adds a region (buffer coordinates, already clipped) to the dirty list, merging where it is cheap
+ */
+static void gfx_add_dirty(gfx_t* gfx, gfx_rect_t rect)
+{
+    int i;
+    bool merged = true;
+
+    //Merge into existing regions while it is under the threshold. A merge can make the region overlap others, so repeat
+    while(merged)
+    {
+        merged = false;
+        for(i=0; i < gfx->mDirtyCount; i++)
+        {
+            if(gfx_rect_merge_cost(&gfx->mDirty[i], &rect) <= gfx->mDirtyMerge)
+            {
+                rect = gfx_rect_union(&gfx->mDirty[i], &rect);
+                gfx->mDirty[i] = gfx->mDirty[--gfx->mDirtyCount];
+                merged = true;
+                break;
+            }
+        }
+    }
+
+    if(gfx->mDirtyCount < GFX_DIRTY_RECT_COUNT)
+    {
+        gfx->mDirty[gfx->mDirtyCount++] = rect;
+        return;
+    }
+
+    //List is full, merge with whichever region grows the least
+    int best = 0;
+    uint32_t bestCost = 0xFFFFFFFF;
+    for(i=0; i < gfx->mDirtyCount; i++)
+    {
+        uint32_t cost = gfx_rect_merge_cost(&gfx->mDirty[i], &rect);
+        if(cost < bestCost)
+        {
+            bestCost = cost;
+            best = i;
+        }
+    }
+
+    gfx->mDirty[best] = gfx_rect_union(&gfx->mDirty[best], &rect);
+}
+
+/**
+ * @brief marks the part of a drawn region that is inside the clip rect as dirty
+ */
+static void gfx_mark_drawn(gfx_t* gfx, int x, int y, int w, int h)
+{
+    if(gfx_clip_rect(gfx, &x, &y, &w, &h))
+    {
+        gfx_mark_dirty(gfx, x, y, w, h);
+    }
+}
+
+/**
+ * @brief marks the bounding box of two points as dirty
+ */
+static inline void gfx_mark_dirty_bounds(gfx_t* gfx, int64_t x0, int64_t y0, int64_t x1, int64_t y1)
+{
+    int64_t minX = (x0 < x1) ? x0 : x1;
+    int64_t minY = (y0 < y1) ? y0 : y1;
+    int64_t maxX = (x0 < x1) ? x1 : x0;
+    int64_t maxY = (y0 < y1) ? y1 : y0;
+
+    //points are 64 bit and clamped to the canvas first, so far apart (or padded) points can not overflow the size
+    if((maxX < 0) || (maxY < 0) || (minX >= gfx->mWidth) || (minY >= gfx->mHeight))
+    {
+        return;
+    }
+
+    minX = (minX < 0) ? 0 : minX;
+    minY = (minY < 0) ? 0 : minY;
+    maxX = (maxX >= gfx->mWidth) ? (gfx->mWidth - 1) : maxX;
+    maxY = (maxY >= gfx->mHeight) ? (gfx->mHeight - 1) : maxY;
+
+    gfx_mark_drawn(gfx, (int)minX, (int)minY, (int)(maxX - minX) + 1, (int)(maxY - minY) + 1);
+}
+
+/**
+ * @brief marks the bounding box of a set of points as dirty
+ * @param pad extra pixels to include around the box
+ */
+static void gfx_mark_dirty_points(gfx_t* gfx, const gfx_point_t* points, int count, int pad)
+{
+    if(count <= 0)
+    {
+        return;
+    }
+
+    int x0 = points[0].mX;
+    int y0 = points[0].mY;
+    int x1 = x0;
+    int y1 = y0;
+
+    for(int i=1; i < count; i++)
+    {
+        x0 = (points[i].mX < x0) ? points[i].mX : x0;
+        y0 = (points[i].mY < y0) ? points[i].mY : y0;
+        x1 = (points[i].mX > x1) ? points[i].mX : x1;
+        y1 = (points[i].mY > y1) ? points[i].mY : y1;
+    }
+
+    gfx_mark_dirty_bounds(gfx, x0 - pad, y0 - pad, x1 + pad, y1 + pad);
+}
+
+/**
+ * @brief writes a single dirty region (buffer coordinates) to the device
+ */
+static mrt_status_t gfx_flush_area(gfx_t* gfx, gfx_rect_t* area)
+{
+    uint32_t stride = (gfx->mWidth * gfx->mPixelSize) / 8;
+    uint32_t rowLen = (area->mWidth * gfx->mPixelSize) / 8;
+    uint8_t* data = &gfx->mBuffer[(((area->mY * gfx->mWidth) + area->mX) * gfx->mPixelSize) / 8];
+    mrt_status_t status = MRT_STATUS_OK;
+
+    if(gfx->fWriteArea != NULL)
+    {
+        return gfx->fWriteArea(gfx, area, data, stride);
+    }
+
+    //the default fWriteBuffer copies into the canvas itself, so there is no device to send to
+    if(gfx->fWriteBuffer == &gfx_write_buffer)
+    {
+        return MRT_STATUS_OK;
+    }
+
+    for(int i=0; (i < area->mHeight) && (status == MRT_STATUS_OK); i++)
+    {
+        status = gfx->fWriteBuffer(gfx, area->mX, area->mY + i, data, rowLen, false);
+        data += stride;
+    }
+
+    return status;
+}
+
+#define GFX_TILE_CHECK  0x01    //tile overlaps a dirty region and needs to be hashed
+#define GFX_TILE_VALID  0x02    //stored hash matches what was last sent to the device
+#define GFX_TILE_CHANGED 0x04   //tile content differs from what was last sent (set until its flush succeeds)
+
+/**
+ * @brief hashes one tile of the buffer (buffer coordinates). FNV-1a style, mixed a word at a time
+ */
+static uint32_t gfx_hash_tile(gfx_t* gfx, int x, int y, int w, int h)
+{
+    uint32_t stride = (gfx->mWidth * gfx->mPixelSize) / 8;
+    uint32_t rowLen = (w * gfx->mPixelSize) / 8;
+    const uint8_t* row = &gfx->mBuffer[(((y * gfx->mWidth) + x) * gfx->mPixelSize) / 8];
+    uint32_t hash = 2166136261u;
+    uint32_t word;
+    uint32_t i;
+
+    while(h--)
+    {
+        for(i=0; i + 4 <= rowLen; i+=4)
+        {
+            memcpy(&word, &row[i], 4);
+            hash = (hash ^ word) * 16777619u;
+        }
+
+        for(; i < rowLen; i++)
+        {
+            hash = (hash ^ row[i]) * 16777619u;
+        }
+
+        row += stride;
+    }
+
+    return hash ^ (hash >> 15);
+}
+
+/**
+ * @brief refresh using the tile hashes. Only tiles covered by dirty regions (or all tiles for a full refresh) are checked,
+ *        and only those whose hash changed are flushed. Changed tiles next to each other in a row are flushed together
+ */
+static mrt_status_t gfx_refresh_tiles(gfx_t* gfx, bool partial)
+{
+    mrt_status_t status = MRT_STATUS_OK;
+    int size = gfx->mTileSize;
+    int col, row, i;
+
+    //find tiles that need checking
+    if(partial)
+    {
+        for(i=0; i < gfx->mDirtyCount; i++)
+        {
+            gfx_rect_t* rect = &gfx->mDirty[i];
+            for(row = rect->mY / size; row <= (rect->mY + rect->mHeight - 1) / size; row++)
+            {
+                for(col = rect->mX / size; col <= (rect->mX + rect->mWidth - 1) / size; col++)
+                {
+                    gfx->mTileState[(row * gfx->mTileCols) + col] |= GFX_TILE_CHECK;
+                }
+            }
+        }
+    }
+    else
+    {
+        for(i=0; i < gfx->mTileCols * gfx->mTileRows; i++)
+        {
+            gfx->mTileState[i] |= GFX_TILE_CHECK;
+        }
+    }
+
+    //anything marked dirty while flushing is kept for the next refresh
+    gfx->mDirtyCount = 0;
+
+    for(row=0; row < gfx->mTileRows; row++)
+    {
+        int y = row * size;
+        int h = (y + size > gfx->mHeight) ? (gfx->mHeight - y) : size;
+        int runStart = -1;
+
+        for(col=0; col <= gfx->mTileCols; col++)
+        {
+            bool changed = false;
+
+            if(col < gfx->mTileCols)
+            {
+                uint8_t* state = &gfx->mTileState[(row * gfx->mTileCols) + col];
+                uint32_t* hash = &gfx->mTileHash[(row * gfx->mTileCols) + col];
+
+                //tiles that failed to flush are checked again even if they are not dirty
+                if(*state & (GFX_TILE_CHECK | GFX_TILE_CHANGED))
+                {
+                    int x = col * size;
+                    int w = (x + size > gfx->mWidth) ? (gfx->mWidth - x) : size;
+                    uint32_t newHash = gfx_hash_tile(gfx, x, y, w, h);
+
+                    changed = !(*state & GFX_TILE_VALID) || (newHash != *hash);
+                    *hash = newHash;
+                    *state = changed ? GFX_TILE_CHANGED : GFX_TILE_VALID;
+                }
+            }
+
+            if(changed && (runStart < 0))
+            {
+                runStart = col;
+            }
+            else if(!changed && (runStart >= 0))
+            {
+                gfx_rect_t area;
+                int x1 = col * size;
+
+                area.mX = runStart * size;
+                area.mY = y;
+                area.mWidth = ((x1 > gfx->mWidth) ? gfx->mWidth : x1) - area.mX;
+                area.mHeight = h;
+                runStart = -1;
+
+                //tiles are only valid once their run has been sent. After a failure the rest stay changed
+                if(status == MRT_STATUS_OK)
+                {
+                    status = gfx_flush_area(gfx, &area);
+                }
+
+                if(status == MRT_STATUS_OK)
+                {
+                    for(i = area.mX / size; i < col; i++)
+                    {
+                        gfx->mTileState[(row * gfx->mTileCols) + i] = GFX_TILE_VALID;
+                    }
+                }
+            }
+        }
+    }
+
+    return status;
+}
+
+
+/**
+ * @brief gets the metrics of a glyph from either glyph table layout
+ */
+static inline void gfx_font_get_glyph(const GFXfont* font, uint16_t glyphIdx, GFXglyph* glyph)
+{
+    if(font->mFlags & GFX_FONT_PACKED)
+    {
+        const GFXpackedGlyph* packed = &((const GFXpackedGlyph*)font->mGlyph)[glyphIdx];
+
+        glyph->mOffset = packed->mOffset;
+        glyph->mWidth = packed->mWidth;
+        glyph->mHeight = packed->mHeight;
+        glyph->mXAdvance = packed->mXAdvance;
+        glyph->mXOffset = packed->mXOffset;
+        glyph->mYOffset = packed->mYOffset;
+    }
+    else
+    {
+        *glyph = font->mGlyph[glyphIdx];
+    }
+}
+
+/**
+ * @brief gets how far a glyph moves the text cursor, from the advance table when the font has one
+ */
+static inline int gfx_font_advance(const GFXfont* font, uint16_t glyphIdx)
+{
+    if(font->mAdvance != NULL)
+    {
+        return font->mAdvance[glyphIdx];
+    }
+
+    if(font->mFlags & GFX_FONT_PACKED)
+    {
+        const GFXpackedGlyph* packed = &((const GFXpackedGlyph*)font->mGlyph)[glyphIdx];
+        return packed->mXOffset + packed->mXAdvance;
+    }
+
+    return font->mGlyph[glyphIdx].mXOffset + font->mGlyph[glyphIdx].mXAdvance;
+}
+
+/**
+ * @brief reads the runs of set pixels of a glyph in row order, from a cached span list, a bitmap or RLE data
+ */
+typedef struct {
+    const uint8_t* mData;       //cached spans, glyph bitmap or RLE runs
+    int mSpanLeft;              //cached spans left, -1 if not reading cached spans
+    bool mRle;                  //mData is RLE runs
+    uint8_t mWidth;             //glyph width
+    uint32_t mPos;              //pixel position (row * width + column)
+    uint32_t mEnd;              //number of pixels in the glyph
+    uint32_t mSetLeft;          //set pixels left in the current RLE run
+} gfx_glyph_runs_t;
+
+/**
+ * @brief starts reading the runs of a glyph
+ * @param data glyph bitmap or RLE data (see gfx_glyph_data), used if cached is NULL
+ * @param cached glyph spans from the glyph cache, or NULL to read data
+ */
+static void gfx_glyph_runs_init(gfx_glyph_runs_t* runs, const GFXfont* font, const GFXglyph* glyph, const uint8_t* data, const gfx_glyph_entry_t* cached)
+{
+    runs->mData = (cached != NULL) ? cached->mSpans : data;
+    runs->mSpanLeft = (cached != NULL) ? cached->mSpanCount : -1;
+    runs->mRle = (font->mFlags & GFX_FONT_RLE) != 0;
+    runs->mWidth = glyph->mWidth;
+    runs->mPos = 0;
+    runs->mEnd = glyph->mWidth * glyph->mHeight;
+    runs->mSetLeft = 0;
+}
+
+/**
+ * @brief gets the next run of set pixels. Runs never cross rows
+ * @return false when there are no runs left
+ */
+static bool gfx_glyph_next_run(gfx_glyph_runs_t* runs, int* row, int* x, int* len)
+{
+    if(runs->mSpanLeft >= 0)
+    {
+        if(runs->mSpanLeft == 0)
+        {
+            return false;
+        }
+
+        *row = runs->mData[0];
+        *x = runs->mData[1];
+        *len = runs->mData[2];
+        runs->mData += 3;
+        runs->mSpanLeft--;
+        return true;
+    }
+
+    if(runs->mRle)
+    {
+        //skip clear runs (and empty set runs) until some set pixels are left
+        while((runs->mSetLeft == 0) && (runs->mPos < runs->mEnd))
+        {
+            runs->mPos += *runs->mData++;
+            if(runs->mPos < runs->mEnd)
+            {
+                runs->mSetLeft = *runs->mData++;
+            }
+        }
+
+        if(runs->mSetLeft == 0)
+        {
+            return false;
+        }
+
+        *row = runs->mPos / runs->mWidth;
+        *x = runs->mPos % runs->mWidth;
+        *len = ((uint32_t)(runs->mWidth - *x) < runs->mSetLeft) ? (runs->mWidth - *x) : (int)runs->mSetLeft;
+        runs->mPos += *len;
+        runs->mSetLeft -= *len;
+        return true;
+    }
+
+    //bitmap: find the next set bit, then where its run ends in the row
+    const uint8_t* bits = runs->mData;
+    uint32_t pos = runs->mPos;
+
+    while((pos < runs->mEnd) && !(bits[pos >> 3] & (0x80 >> (pos & 7))))
+    {
+        //whole clear bytes are skipped at once
+        pos = ((pos & 7) == 0 && bits[pos >> 3] == 0) ? (pos + 8) : (pos + 1);
+    }
+
+    if(pos >= runs->mEnd)
+    {
+        runs->mPos = runs->mEnd;
+        return false;
+    }
+
+    *row = pos / runs->mWidth;
+    *x = pos % runs->mWidth;
+
+    uint32_t rowEnd = pos - *x + runs->mWidth;
+    uint32_t end = pos;
+    while((end < rowEnd) && (bits[end >> 3] & (0x80 >> (end & 7))))
+    {
+        end++;
+    }
+
+    *len = end - pos;
+    runs->mPos = end;
+    return true;
+}
+
+/**
+ * @brief decompresses a block in the LZ4 block format (no frame header)
+ * @param dstLen number of bytes to decompress. Decoding stops once they are written, so only the start of a block can
+ *        be decompressed
+ * @return number of bytes written, or -1 if the block is corrupt
+ */
+static int gfx_lz4_decode(const uint8_t* src, uint32_t srcLen, uint8_t* dst, uint32_t dstLen)
+{
+    const uint8_t* end = src + srcLen;
+    uint32_t out = 0;
+
+    while(src < end)
+    {
+        uint8_t token = *src++;
+        uint32_t len = token >> 4;
+        uint8_t b;
+
+        //literals
+        if(len == 15)
+        {
+            do
+            {
+                if(src >= end)
+                {
+                    return -1;
+                }
+                b = *src++;
+                len += b;
+            } while(b == 255);
+        }
+
+        if(len > (uint32_t)(end - src))
+        {
+            return -1;
+        }
+        if(len >= dstLen - out)
+        {
+            memcpy(&dst[out], src, dstLen - out);
+            return (int)dstLen;
+        }
+        memcpy(&dst[out], src, len);
+        src += len;
+        out += len;
+
+        //the last sequence only has literals
+        if(src >= end)
+        {
+            break;
+        }
+
+        //match
+        if(end - src < 2)
+        {
+            return -1;
+        }
+        uint32_t offset = src[0] | (src[1] << 8);
+        src += 2;
+
+        len = token & 0x0F;
+        if(len == 15)
+        {
+            do
+            {
+                if(src >= end)
+                {
+                    return -1;
+                }
+                b = *src++;
+                len += b;
+            } while(b == 255);
+        }
+        len += 4;
+
+        if((offset == 0) || (offset > out))
+        {
+            return -1;
+        }
+        len = (len > dstLen - out) ? (dstLen - out) : len;
+
+        //matches may overlap what they write, so bytes are copied in order
+        for(uint32_t i=0; i < len; i++, out++)
+        {
+            dst[out] = dst[out - offset];
+        }
+
+        if(out == dstLen)
+        {
+            break;
+        }
+    }
+
+    return (int)out;
+}
+
+/**
+ * @brief gets the bitmap (or RLE) data of a glyph, decompressing its block for GFX_FONT_LZ fonts
+ * @param cache glyph cache to keep the decompressed block in, or NULL
+ * @param scratch GFX_GLYPH_SCRATCH_SIZE bytes to decompress into when there is no cache (NULL with a cache)
+ * @param heap set to a buffer the caller must free when the glyph does not fit in scratch, otherwise left NULL
+ * @return glyph data, or NULL if the block could not be decompressed
+ */
+static const uint8_t* gfx_glyph_data(const GFXfont* font, const GFXglyph* glyph, gfx_glyph_cache_t* cache, uint8_t* scratch, uint8_t** heap)
+{
+    uint32_t pixels = glyph->mWidth * glyph->mHeight;
+
+    //empty glyphs (such as spaces) have no data, so there is no block to decompress
+    if(pixels == 0)
+    {
+        return font->mBitmap;
+    }
+
+    if(!(font->mFlags & GFX_FONT_LZ))
+    {
+        return &font->mBitmap[glyph->mOffset];
+    }
+
+    //find the last block starting at or before the glyph
+    int lo = 0;
+    int hi = font->mBlockCount - 1;
+    uint32_t offset = (uint32_t)glyph->mOffset;
+
+    while(lo < hi)
+    {
+        int mid = (lo + hi + 1) / 2;
+
+        if(font->mBlocks[mid].mStart <= offset)
+        {
+            lo = mid;
+        }
+        else
+        {
+            hi = mid - 1;
+        }
+    }
+
+    const GFXblock* block = &font->mBlocks[lo];
+    uint32_t size = block[1].mStart - block->mStart;
+    uint32_t start = offset - block->mStart;
+    uint8_t* dst;
+
+    if(start >= size)
+    {
+        return NULL;
+    }
+
+    if((cache != NULL) && (cache->mBlockFont == font) && (cache->mBlockIdx == lo))
+    {
+        return &cache->mBlock[start];
+    }
+
+    if(cache != NULL)
+    {
+        if(cache->mBlockSize < size)
+        {
+            free(cache->mBlock);
+            cache->mBlock = (uint8_t*) malloc(size);
+            cache->mBlockSize = (cache->mBlock != NULL) ? size : 0;
+        }
+        cache->mBlockFont = NULL;
+        dst = cache->mBlock;
+    }
+    else
+    {
+        //without a cache the block is only decompressed up to the end of the glyph (RLE data is at most one byte per
+        //pixel, plus the zero length runs that split long runs)
+        uint32_t len = (font->mFlags & GFX_FONT_RLE) ? (pixels + (pixels / 255) + 1) : ((pixels + 7) / 8);
+
+        size = (len < size - start) ? (start + len) : size;
+        dst = (size <= GFX_GLYPH_SCRATCH_SIZE) ? scratch : (*heap = (uint8_t*) malloc(size));
+    }
+
+    if((dst == NULL) || (gfx_lz4_decode(&font->mBitmap[block->mOffset], block[1].mOffset - block->mOffset, dst, size) != (int)size))
+    {
+        return NULL;
+    }
+
+    if(cache != NULL)
+    {
+        cache->mBlockFont = font;
+        cache->mBlockIdx = lo;
+        cache->mBlockLoads++;
+    }
+
+    return &dst[start];
+}
+
+/**
+ * @brief hashes a glyph cache key to a bucket
+ */
+static inline uint16_t gfx_glyph_bucket(const GFXfont* font, uint16_t glyph)
+{
+    uint32_t key = (uint32_t)(uintptr_t)font ^ (glyph * 2654435761u);
+    return (uint16_t)((key ^ (key >> 16)) % GFX_GLYPH_CACHE_SLOTS);
+}
+
+/**
+ * @brief removes an entry from the glyph cache and frees its spans
+ */
+static void gfx_glyph_evict(gfx_glyph_cache_t* cache, int slot)
+{
+    gfx_glyph_entry_t* entry = &cache->mEntries[slot];
+    int16_t* link = &cache->mBuckets[gfx_glyph_bucket(entry->mFont, entry->mGlyph)];
+
+    while(*link != slot)
+    {
+        link = &cache->mEntries[*link].mNext;
+    }
+    *link = entry->mNext;
+
+    cache->mUsed -= entry->mSpanCount * 3;
+    free(entry->mSpans);
+    entry->mSpans = NULL;
+    entry->mFont = NULL;
+}
+
+/**
+ * @brief gets a glyph from the cache, rasterizing it into spans on a miss
+ * @return cache entry, or NULL if the glyph could not be cached (too large for the budget, or out of memory)
+ */
+static gfx_glyph_entry_t* gfx_glyph_lookup(gfx_glyph_cache_t* cache, const GFXfont* font, uint16_t glyphIdx)
+{
+    GFXglyph metrics;
+    const GFXglyph* glyph = &metrics;
+    const uint8_t* data;
+    uint16_t bucket = gfx_glyph_bucket(font, glyphIdx);
+    uint32_t spanCount = 0;
+    gfx_glyph_runs_t runs;
+    int slot;
+    int row, x, len;
+
+    cache->mClock++;
+
+    for(slot = cache->mBuckets[bucket]; slot >= 0; slot = cache->mEntries[slot].mNext)
+    {
+        if((cache->mEntries[slot].mFont == font) && (cache->mEntries[slot].mGlyph == glyphIdx))
+        {
+            cache->mEntries[slot].mLastUse = cache->mClock;
+            cache->mHits++;
+            return &cache->mEntries[slot];
+        }
+    }
+
+    cache->mMisses++;
+
+    gfx_font_get_glyph(font, glyphIdx, &metrics);
+    data = gfx_glyph_data(font, glyph, cache, NULL, NULL);
+    if(data == NULL)
+    {
+        return NULL;
+    }
+
+    //count spans first, so the entry is allocated once at its final size
+    gfx_glyph_runs_init(&runs, font, glyph, data, NULL);
+    while(gfx_glyph_next_run(&runs, &row, &x, &len))
+    {
+        spanCount++;
+    }
+
+    uint32_t size = spanCount * 3;
+    if(size > cache->mBudget)
+    {
+        return NULL;
+    }
+
+    //make room, evicting the least recently used glyphs
+    for(;;)
+    {
+        int freeSlot = -1;
+        int oldest = -1;
+
+        for(int i=0; i < GFX_GLYPH_CACHE_SLOTS; i++)
+        {
+            if(cache->mEntries[i].mFont == NULL)
+            {
+                freeSlot = (freeSlot < 0) ? i : freeSlot;
+            }
+            else if((oldest < 0) || ((cache->mClock - cache->mEntries[i].mLastUse) > (cache->mClock - cache->mEntries[oldest].mLastUse)))
+            {
+                oldest = i;
+            }
+        }
+
+        if((freeSlot >= 0) && (cache->mUsed + size <= cache->mBudget))
+        {
+            slot = freeSlot;
+            break;
+        }
+
+        gfx_glyph_evict(cache, oldest);
+    }
+
+    gfx_glyph_entry_t* entry = &cache->mEntries[slot];
+
+    entry->mSpans = (uint8_t*) malloc((size) ? size : 1);
+    if(entry->mSpans == NULL)
+    {
+        return NULL;
+    }
+
+    entry->mSpanCount = 0;
+    gfx_glyph_runs_init(&runs, font, glyph, data, NULL);
+    while(gfx_glyph_next_run(&runs, &row, &x, &len))
+    {
+        entry->mSpans[(entry->mSpanCount * 3)] = (uint8_t)row;
+        entry->mSpans[(entry->mSpanCount * 3) + 1] = (uint8_t)x;
+        entry->mSpans[(entry->mSpanCount * 3) + 2] = (uint8_t)len;
+        entry->mSpanCount++;
+    }
+
+    entry->mFont = font;
+    entry->mGlyph = glyphIdx;
+    entry->mLastUse = cache->mClock;
+    entry->mNext = cache->mBuckets[bucket];
+    cache->mBuckets[bucket] = slot;
+    cache->mUsed += size;
+
+    return entry;
+}
+
+/**
+ * @brief draws the runs of a glyph (cached spans or RLE data) with the pen color
+ * @param x x coord of the glyph bitmap's top left corner
+ * @param y y coord of the glyph bitmap's top left corner
+ */
+static void gfx_draw_glyph_runs(gfx_t* gfx, int x, int y, const GFXglyph* glyph, gfx_glyph_runs_t* runs)
+{
+    uint32_t color = gfx->mPen.mPacked;
+    int row, col, len;
+
+    //glyphs entirely inside the clip rect skip per span clipping
+    bool inside = (x >= gfx->mClip.mX) && (y >= gfx->mClip.mY) &&
+                  (x + glyph->mWidth <= GFX_CLIP_X1(gfx)) && (y + glyph->mHeight <= GFX_CLIP_Y1(gfx));
+
+    while(gfx_glyph_next_run(runs, &row, &col, &len))
+    {
+        if(inside)
+        {
+            gfx->fSpan(gfx, x + col, y + row, len, color);
+        }
+        else
+        {
+            gfx_write_span(gfx, x + col, y + row, len, color);
+        }
+    }
+}
+
+/**
+ * @brief writes one foreground run of an opaque text row, filling the gap before it with the background
+ * @param bgSpan writer for the background, or NULL if the row background is already painted
+ * @param pos first column of the row not written yet, updated
+ * @param end column after the last one of the cell (already clipped)
+ */
+static inline void gfx_cell_run(gfx_t* gfx, f_gfx_span bgSpan, int y, int* pos, int end, int runX, int runLen)
+{
+    int runEnd = (runX + runLen < end) ? (runX + runLen) : end;
+
+    runX = (runX > *pos) ? runX : *pos;
+    if(runX >= runEnd)
+    {
+        return;
+    }
+
+    if((bgSpan != NULL) && (runX > *pos))
+    {
+        bgSpan(gfx, *pos, y, runX - *pos, gfx->mPen.mBackground);
+    }
+    gfx->fSpan(gfx, runX, y, runEnd - runX, gfx->mPen.mPacked);
+    *pos = runEnd;
+}
+
+/**
+ * @brief paints a text cell (background and glyph) row by row, so every pixel in the cell is written exactly once
+ * @note glyph pixels outside of the cell are cut, since the next cell's background would paint over them
+ * @note pens that blend or use a raster op need the background under the glyph, so rows are painted first in that case
+ * @param x x coord of the left of the cell (text cursor)
+ * @param y y coord of the baseline
+ * @param top y coord of the top of the cell
+ * @param height height of the cell
+ * @param glyph glyph to draw
+ * @param runs runs of the glyph
+ */
+static void gfx_print_cell(gfx_t* gfx, int x, int y, int top, int height, const GFXglyph* glyph, gfx_glyph_runs_t* runs)
+{
+    int runRow, runX, runLen;
+    bool more = gfx_glyph_next_run(runs, &runRow, &runX, &runLen);
+    f_gfx_span bgSpan = gfx_plain_span(gfx);
+    bool layered = !gfx_writes_plain(gfx);
+    int gx = x + glyph->mXOffset;
+    int gy = y + glyph->mYOffset;
+
+    //clip the cell once
+    int x0 = (x > gfx->mClip.mX) ? x : gfx->mClip.mX;
+    int x1 = x + glyph->mXOffset + glyph->mXAdvance;
+    int y0 = (top > gfx->mClip.mY) ? top : gfx->mClip.mY;
+    int y1 = top + height;
+
+    x1 = (x1 < GFX_CLIP_X1(gfx)) ? x1 : GFX_CLIP_X1(gfx);
+    y1 = (y1 < GFX_CLIP_Y1(gfx)) ? y1 : GFX_CLIP_Y1(gfx);
+
+    if(x0 >= x1)
+    {
+        return;
+    }
+
+    for(int row = y0; row < y1; row++)
+    {
+        int pos = x0;
+        int glyphRow = row - gy;
+        f_gfx_span gapSpan = bgSpan;
+
+        if(layered)
+        {
+            bgSpan(gfx, x0, row, x1 - x0, gfx->mPen.mBackground);
+            gapSpan = NULL;
+        }
+
+        //runs come in row order, so rows above the clip are skipped and the rest are read as they are reached
+        while(more && (runRow < glyphRow))
+        {
+            more = gfx_glyph_next_run(runs, &runRow, &runX, &runLen);
+        }
+
+        while(more && (runRow == glyphRow))
+        {
+            gfx_cell_run(gfx, gapSpan, row, &pos, x1, gx + runX, runLen);
+            more = gfx_glyph_next_run(runs, &runRow, &runX, &runLen);
+        }
+
+        if((gapSpan != NULL) && (pos < x1))
+        {
+            bgSpan(gfx, pos, row, x1 - pos, gfx->mPen.mBackground);
+        }
+    }
+}
+
+/**
+ * @brief gets the number of glyphs in a font
+ */
+static int gfx_font_glyph_count(const GFXfont* font)
+{
+    int count = 0;
+
+    if(font->mRanges == NULL)
+    {
+        return font->mLast - font->mFirst + 1;
+    }
+
+    for(int i=0; i < font->mRangeCount; i++)
+    {
+        int end = font->mRanges[i].mGlyph + font->mRanges[i].mCount;
+        count = (end > count) ? end : count;
+    }
+
+    return count;
+}
+
+/**
+ * @brief finds the glyph for a codepoint. Fonts with a range table are binary searched
+ * @param glyphIdx index of the glyph in the font
+ * @return false if the font has no glyph for the codepoint
+ */
+static bool gfx_font_glyph(const GFXfont* font, uint32_t codepoint, uint16_t* glyphIdx)
+{
+    if(font->mRanges == NULL)
+    {
+        if((codepoint < font->mFirst) || (codepoint > font->mLast))
+        {
+            return false;
+        }
+
+        *glyphIdx = codepoint - font->mFirst;
+        return true;
+    }
+
+    int lo = 0;
+    int hi = font->mRangeCount - 1;
+
+    while(lo <= hi)
+    {
+        int mid = (lo + hi) / 2;
+        const GFXrange* range = &font->mRanges[mid];
+
+        if(codepoint < range->mFirst)
+        {
+            hi = mid - 1;
+        }
+        else if(codepoint >= range->mFirst + range->mCount)
+        {
+            lo = mid + 1;
+        }
+        else
+        {
+            *glyphIdx = range->mGlyph + (codepoint - range->mFirst);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/**
+ * @brief decodes the next codepoint of a UTF-8 string
+ * @note a byte that does not start a valid sequence (bad lead byte, bad or missing continuation bytes, overlong or
+ *       surrogate encodings) is returned as its own value, so Latin-1 text still prints with Latin-1 fonts
+ * @param text ptr to the string position, advanced past the codepoint
+ */
+static inline uint32_t gfx_utf8_next(const char** text)
+{
+    const uint8_t* s = (const uint8_t*)*text;
+    uint32_t cp = s[0];
+
+    //ASCII is most text, so it skips decoding
+    if(cp < 0x80)
+    {
+        (*text)++;
+        return cp;
+    }
+
+    int len = (cp >= 0xF0 && cp <= 0xF4) ? 4 : (cp >= 0xE0) ? 3 : (cp >= 0xC2) ? 2 : 1;
+
+    if((cp < 0x80) || (cp > 0xF4))
+    {
+        len = 1;
+    }
+
+    if(len > 1)
+    {
+        static const uint32_t min[5] = {0, 0, 0x80, 0x800, 0x10000};
+        uint32_t value = cp & (0x7F >> len);
+
+        for(int i=1; i < len; i++)
+        {
+            if((s[i] & 0xC0) != 0x80)
+            {
+                len = 1;
+                break;
+            }
+            value = (value << 6) | (s[i] & 0x3F);
+        }
+
+        if((len > 1) && (value >= min[len]) && (value <= 0x10FFFF) && ((value < 0xD800) || (value > 0xDFFF)))
+        {
+            cp = value;
+        }
+        else
+        {
+            len = 1;
+        }
+    }
+
+    *text += len;
+    return cp;
+}
+
+/**
+ * @brief computes the metrics of a font by scanning its glyphs
+ * @note empty glyphs with no advance (gaps in a font) are left out of the advances
+ */
+static void gfx_font_compute_metrics(const GFXfont* font, GFXmetrics* metrics)
+{
+    int count = gfx_font_glyph_count(font);
+    int ascent = 0, descent = 0, maxAdvance = 0, total = 0, used = 0;
+    int fixed = -1;
+
+    for(int i=0; i < count; i++)
+    {
+        GFXglyph glyph;
+        int advance;
+
+        gfx_font_get_glyph(font, i, &glyph);
+        advance = glyph.mXOffset + glyph.mXAdvance;
+        ascent = (-glyph.mYOffset > ascent) ? -glyph.mYOffset : ascent;
+        descent = (glyph.mYOffset + glyph.mHeight > descent) ? (glyph.mYOffset + glyph.mHeight) : descent;
+
+        if((advance == 0) && (glyph.mWidth == 0))
+        {
+            continue;
+        }
+
+        maxAdvance = (advance > maxAdvance) ? advance : maxAdvance;
+        fixed = ((fixed < 0) || (fixed == advance)) ? advance : 0;
+        total += advance;
+        used++;
+    }
+
+    metrics->mAscent = ascent;
+    metrics->mDescent = descent;
+    metrics->mMaxAdvance = maxAdvance;
+    metrics->mAvgAdvance = used ? ((total + (used / 2)) / used) : 0;
+    metrics->mFixedAdvance = (fixed > 0) ? fixed : 0;
+}
+
+/**
+ * @brief gets the metrics of a font, stored with the font or computed once and kept in the gfx_t
+ * @param gfx gfx_t to keep computed metrics in, or NULL
+ * @param scratch where to compute the metrics when there is no gfx_t
+ */
+static const GFXmetrics* gfx_font_metrics(gfx_t* gfx, const GFXfont* font, GFXmetrics* scratch)
+{
+    if(font->mMetrics != NULL)
+    {
+        return font->mMetrics;
+    }
+
+    if(gfx == NULL)
+    {
+        gfx_font_compute_metrics(font, scratch);
+        return scratch;
+    }
+
+    if(gfx->mMetricsFont != font)
+    {
+        gfx_font_compute_metrics(font, &gfx->mMetrics);
+        gfx->mMetricsFont = font;
+    }
+
+    return &gfx->mMetrics;
+}
+
+/* Exported functions ------------------------------------------------------- */
+
+mrt_status_t gfx_convert_color(gfx_color_t* color, gfx_color_mode_e target)
+{
+    uint32_t src;
+    uint32_t dst = 0;
+
+    if(target == color->mMode)
+    {
+        return MRT_STATUS_OK;
+    }
+
+    src = gfx_pack_color(color->mMode, color);
+    gfx_convert_span((const uint8_t*)&src, color->mMode, (uint8_t*)&dst, target, 1);
+    gfx_unpack_color(target, dst, color);
+
+    return MRT_STATUS_OK;
+}
+
+mrt_status_t gfx_convert_span(const uint8_t* src, gfx_color_mode_e srcMode, uint8_t* dst, gfx_color_mode_e dstMode, int count)
+{
+    uint8_t rgba[GFX_CONVERT_CHUNK * 4];
+    uint8_t srcSize = gfx_mode_bytes(srcMode);
+    uint8_t dstSize = gfx_mode_bytes(dstMode);
+
+    if(count <= 0)
+    {
+        return MRT_STATUS_OK;
+    }
+
+    if(srcMode == dstMode)
+    {
+        memmove(dst, src, (srcSize) ? (count * srcSize) : ((count + 7) / 8));
+        return MRT_STATUS_OK;
+    }
+
+    //direct kernels for the common pairs
+    if((srcMode == GFX_COLOR_MODE_888A) && (dstMode == GFX_COLOR_MODE_A888))
+    {
+        gfx_swizzle_8888(src, dst, count, true);
+        return MRT_STATUS_OK;
+    }
+
+    if((srcMode == GFX_COLOR_MODE_A888) && (dstMode == GFX_COLOR_MODE_888A))
+    {
+        gfx_swizzle_8888(src, dst, count, false);
+        return MRT_STATUS_OK;
+    }
+
+    if((srcMode == GFX_COLOR_MODE_888) && (dstMode == GFX_COLOR_MODE_565))
+    {
+        gfx_888_to_565(src, dst, count);
+        return MRT_STATUS_OK;
+    }
+
+    if((srcMode == GFX_COLOR_MODE_565) && (dstMode == GFX_COLOR_MODE_888))
+    {
+        gfx_565_to_888(src, dst, count);
+        return MRT_STATUS_OK;
+    }
+
+    //everything else goes through rgba in batches. Batches are a multiple of 8 pixels, so MONO batches stay byte aligned
+    while(count > 0)
+    {
+        int n = (count < GFX_CONVERT_CHUNK) ? count : GFX_CONVERT_CHUNK;
+
+        gfx_decode_row(srcMode, src, rgba, n);
+        gfx_encode_row(dstMode, rgba, dst, n);
+
+        src += (srcSize) ? (n * srcSize) : (n / 8);
+        dst += (dstSize) ? (n * dstSize) : (n / 8);
+        count -= n;
+    }
+
+    return MRT_STATUS_OK;
+}
+
+mrt_status_t gfx_init_buffered(gfx_t* gfx, int width, int height, gfx_color_mode_e mode)
+{
+
+    gfx_select_writers(gfx, mode, true);
+    
+    gfx->mMode = mode;
+    gfx->mBufferSize = (((width * height) * (gfx->mPixelSize)) + 7) / 8;
+    gfx->mBuffer = (uint8_t*) malloc(gfx->mBufferSize);
+    memset(gfx->mBuffer,0,gfx->mBufferSize);
+    gfx->mWidth = width;
+    gfx->mHeight = height;
+    gfx->mFont  = NULL;
+    gfx->fWritePixel = &gfx_write_pixel;
+    gfx->fWriteBuffer = &gfx_write_buffer;
+    gfx->mDevice  = NULL;
+    gfx->mBuffered = true;
+    gfx->fWriteArea = NULL;
+    gfx->mDirtyCount = 0;
+    gfx->mDirtyMerge = GFX_DIRTY_MERGE_DEFAULT;
+    gfx->mTileHash = NULL;
+    gfx->mTileState = NULL;
+    gfx->mTileSize = 0;
+    gfx->mClip.mX = 0;
+    gfx->mClip.mY = 0;
+    gfx->mClip.mWidth = width;
+    gfx->mClip.mHeight = height;
+    gfx->mClipDepth = 0;
+    gfx->mGlyphCache = NULL;
+    gfx->mMetricsFont = NULL;
+    gfx_set_flags(gfx, GFX_FLAG_NONE);
+    gfx->mPen.mRop = GFX_ROP_COPY;
+    gfx_set_pen(gfx,1,GFX_COLOR_WHITE);
+    gfx_set_background(gfx, GFX_COLOR_BLACK);
+    gfx_mark_dirty(gfx, 0, 0, width, height); //contents of the device are unknown until the first refresh
+
+    return MRT_STATUS_OK;
+}
+
+mrt_status_t gfx_init_unbuffered(gfx_t* gfx, int width, int height, gfx_color_mode_e mode, f_gfx_write_pixel write_cb, void* dev )
+{
+
+    //Without a callback there is nowhere to draw but the (missing) local buffer, so keep the direct writers
+    gfx_select_writers(gfx, mode, (write_cb == NULL));
+
+    gfx->mMode = mode;
+    gfx->mBufferSize = (((width * height) * (gfx->mPixelSize)) + 7) / 8;
+    gfx->mBuffer = NULL;
+    gfx->mWidth = width;
+    gfx->mHeight = height;
+    gfx->mFont  = NULL;
+    if(write_cb == NULL)
+    {
+        gfx->fWritePixel = &gfx_write_pixel; 
+    }
+    else 
+    {
+        gfx->fWritePixel = write_cb;
+    }
+    gfx->fWriteBuffer = &gfx_write_buffer;
+    gfx->mDevice  = dev;
+    gfx->mBuffered = false;
+    gfx->fWriteArea = NULL;
+    gfx->mDirtyCount = 0;
+    gfx->mDirtyMerge = GFX_DIRTY_MERGE_DEFAULT;
+    gfx->mTileHash = NULL;
+    gfx->mTileState = NULL;
+    gfx->mTileSize = 0;
+    gfx->mClip.mX = 0;
+    gfx->mClip.mY = 0;
+    gfx->mClip.mWidth = width;
+    gfx->mClip.mHeight = height;
+    gfx->mClipDepth = 0;
+    gfx->mGlyphCache = NULL;
+    gfx->mMetricsFont = NULL;
+    gfx_set_flags(gfx, GFX_FLAG_NONE);
+    gfx->mPen.mRop = GFX_ROP_COPY;
+    gfx_set_pen(gfx,1,GFX_COLOR_WHITE);
+    gfx_set_background(gfx, GFX_COLOR_BLACK);
+
+    return MRT_STATUS_OK;
+}
+
+
+mrt_status_t gfx_deinit(gfx_t* gfx)
+{
+    gfx->mBufferSize = 0;
+    gfx->mWidth =0;
+    gfx->mHeight = 0;
+
+  //if the gfx object manages its own buffer, free it from memory
+  if(gfx->mBuffered)
+  {
+    free(gfx->mBuffer);
+  }
+
+    gfx_enable_tile_hash(gfx, 0);
+    gfx_enable_glyph_cache(gfx, 0);
+
+    return MRT_STATUS_OK;
+}
+
+mrt_status_t gfx_set_pen(gfx_t* gfx, uint32_t stroke, gfx_color_t color)
+{
+    gfx_color_t rgba = color;
+
+    gfx->mPen.mColor = color; 
+    gfx->mPen.mStroke = stroke;
+    gfx_convert_color(&gfx->mPen.mColor, gfx->mMode); //Convert color to match canvas mode
+    gfx->mPen.mPacked = gfx_pack_color(gfx->mMode, &gfx->mPen.mColor);
+
+    //Keep the straight alpha color for blending (colors without an alpha channel are opaque)
+    gfx_convert_color(&rgba, GFX_COLOR_MODE_888A);
+    gfx->mPen.mRGBA[0] = rgba.mData.mRGBAdata.r;
+    gfx->mPen.mRGBA[1] = rgba.mData.mRGBAdata.g;
+    gfx->mPen.mRGBA[2] = rgba.mData.mRGBAdata.b;
+    gfx->mPen.mRGBA[3] = rgba.mData.mRGBAdata.alpha;
+    gfx_select_pen_writers(gfx);
+
+    return MRT_STATUS_OK;
+}
+
+mrt_status_t gfx_set_rop(gfx_t* gfx, gfx_rop_e rop)
+{
+    gfx->mPen.mRop = rop;
+    gfx_select_pen_writers(gfx);
+
+    return MRT_STATUS_OK;
+}
+
+mrt_status_t gfx_set_background(gfx_t* gfx, gfx_color_t color)
+{
+    gfx_convert_color(&color, gfx->mMode);
+    gfx->mPen.mBackground = gfx_pack_color(gfx->mMode, &color);
+
+    return MRT_STATUS_OK;
+}
+
+mrt_status_t gfx_set_flags(gfx_t* gfx, uint32_t flags)
+{
+    gfx->mFlags = flags;
+
+    //Fold orientation into the index mapping so the pixel writers never test flags
+    gfx->mOrigin = 0;
+    gfx->mXStep = 1;
+    gfx->mYStep = gfx->mWidth;
+
+    if(flags & GFX_FLAG_HFLIP)
+    {
+        gfx->mOrigin += gfx->mWidth - 1;
+        gfx->mXStep = -1;
+    }
+
+    if(flags & GFX_FLAG_VFLIP)
+    {
+        gfx->mOrigin += (gfx->mHeight - 1) * gfx->mWidth;
+        gfx->mYStep = -gfx->mWidth;
+    }
+
+    return MRT_STATUS_OK;
+}
+
+mrt_status_t gfx_write_pixel(gfx_t* gfx, int x, int y, gfx_color_t* val)
+{
+    //If we are outside of the clip rect, ignore
+    if((x < gfx->mClip.mX) || (x >= GFX_CLIP_X1(gfx)) || (y < gfx->mClip.mY) || (y >= GFX_CLIP_Y1(gfx)))
+    {
+        return MRT_STATUS_OK;
+    }
+
+    //explicit colors are stored as is, even if the pen blends
+    gfx_plain_plot(gfx)(gfx, x, y, gfx_pack_color(gfx->mMode, val));
+    gfx_mark_dirty(gfx, x, y, 1, 1);
+
+    return MRT_STATUS_OK;
+}
+
+mrt_status_t gfx_write_buffer(gfx_t* gfx, int x, int y, uint8_t* data, int len, bool wrap)
+{
+    uint32_t pixelCount = ((uint32_t)len * 8) / gfx->mPixelSize;
+    uint32_t bytesPerPixel = gfx->mPixelSize / 8;
+    uint32_t srcBit = 0;
+    uint32_t packed;
+
+    if((data == NULL) || (len < 0) || ( x < 0) || (x >= gfx->mWidth) || (y < 0) || (y>= gfx->mHeight))
+    {
+        return MRT_STATUS_ERROR;
+    }
+
+    //buffer data is stored as is, even if the pen blends. Rows can be copied whole when they go straight to the buffer in
+    //the same direction
+    f_gfx_plot plot = gfx_plain_plot(gfx);
+    bool rowCopy = (plot != &gfx_plot_cb) && (gfx->mXStep > 0);
+
+    while((pixelCount > 0) && (y < gfx->mHeight))
+    {
+        uint32_t rowLen = gfx->mWidth - x;
+        if(rowLen > pixelCount)
+        {
+            rowLen = pixelCount;
+        }
+
+        //only the part of the row inside the clip rect is written, the rest of its data is skipped
+        int start = (x < gfx->mClip.mX) ? gfx->mClip.mX : x;
+        int end = ((x + (int)rowLen) > GFX_CLIP_X1(gfx)) ? GFX_CLIP_X1(gfx) : (x + (int)rowLen);
+        uint32_t skip = (uint32_t)(start - x);
+
+        if((y < gfx->mClip.mY) || (y >= GFX_CLIP_Y1(gfx)) || (end <= start))
+        {
+            end = start;
+        }
+
+        if((end > start) && rowCopy)
+        {
+            uint32_t idx = GFX_PIXEL_INDEX(gfx, start, y);
+            uint32_t bit = srcBit + (skip * gfx->mPixelSize);
+
+            if(gfx->mMode == GFX_COLOR_MODE_MONO)
+            {
+                gfx_copy_bits(gfx->mBuffer, idx, data, bit, end - start);
+            }
+            else if(&gfx->mBuffer[idx * bytesPerPixel] != &data[bit / 8])
+            {
+                memcpy(&gfx->mBuffer[idx * bytesPerPixel], &data[bit / 8], (end - start) * bytesPerPixel);
+            }
+        }
+        else
+        {
+            for(uint32_t i=skip; i < skip + (uint32_t)(end - start); i++)
+            {
+                if(gfx->mMode == GFX_COLOR_MODE_MONO)
+                {
+                    uint32_t bit = srcBit + i;
+                    packed = (data[bit >> 3] & (0x80 >> (bit & 7))) ? 0xFF : 0x00;
+                }
+                else
+                {
+                    packed = 0;
+                    memcpy(&packed, &data[(srcBit / 8) + (i * bytesPerPixel)], bytesPerPixel);
+                }
+                plot(gfx, x + i, y, packed);
+            }
+        }
+
+        gfx_mark_dirty(gfx, start, y, end - start, 1);
+        srcBit += rowLen * gfx->mPixelSize;
+        pixelCount -= rowLen;
+
+        if(!wrap)
+        {
+            break;
+        }
+        y++;
+    }
+
+    return MRT_STATUS_OK;
+}
+
+mrt_status_t gfx_refresh(gfx_t* gfx)
+{
+    mrt_status_t status = MRT_STATUS_OK;
+
+    if((gfx->mTileHash != NULL) && (gfx->mBuffer != NULL))
+    {
+        return gfx_refresh_tiles(gfx, (gfx->mFlags & GFX_FLAG_PARTIAL_REFRESH));
+    }
+
+    if(!(gfx->mFlags & GFX_FLAG_PARTIAL_REFRESH) || (gfx->mBuffer == NULL))
+    {
+        gfx->mDirtyCount = 0;
+
+        //the default fWriteBuffer copies into the canvas itself, so there is no device to send to
+        if(gfx->fWriteBuffer == &gfx_write_buffer)
+        {
+            return MRT_STATUS_OK;
+        }
+
+        return gfx->fWriteBuffer(gfx, 0,0,gfx->mBuffer, gfx->mBufferSize, true);
+    }
+
+    //take the regions and clear the list first, so anything marked dirty while flushing is kept for the next refresh
+    gfx_rect_t dirty[GFX_DIRTY_RECT_COUNT];
+    int count = gfx->mDirtyCount;
+
+    memcpy(dirty, gfx->mDirty, count * sizeof(gfx_rect_t));
+    gfx->mDirtyCount = 0;
+
+    for(int i=0; (i < count) && (status == MRT_STATUS_OK); i++)
+    {
+        status = gfx_flush_area(gfx, &dirty[i]);
+    }
+
+    return status;
+}
+
+mrt_status_t gfx_mark_dirty(gfx_t* gfx, int x, int y, int w, int h)
+{
+    gfx_rect_t rect;
+
+    //Only a local buffer needs to be flushed
+    if(gfx->mBuffer == NULL)
+    {
+        return MRT_STATUS_OK;
+    }
+
+    //far corners are clamped in 64 bits, so any rectangle of int coords is handled
+    int64_t x1 = (int64_t)x + w;
+    int64_t y1 = (int64_t)y + h;
+
+    x = (x < 0) ? 0 : x;
+    y = (y < 0) ? 0 : y;
+    x1 = (x1 > gfx->mWidth) ? gfx->mWidth : x1;
+    y1 = (y1 > gfx->mHeight) ? gfx->mHeight : y1;
+
+    if((x1 <= x) || (y1 <= y))
+    {
+        return MRT_STATUS_OK;
+    }
+
+    w = (int)(x1 - x);
+    h = (int)(y1 - y);
+
+    //Regions are tracked in buffer coordinates
+    if(gfx->mXStep < 0)
+    {
+        x = gfx->mWidth - x - w;
+    }
+
+    if(gfx->mYStep < 0)
+    {
+        y = gfx->mHeight - y - h;
+    }
+
+    //MONO regions are flushed as whole bytes. If rows do not start on a byte boundary, flush whole frames
+    if(gfx->mMode == GFX_COLOR_MODE_MONO)
+    {
+        if(gfx->mWidth % 8)
+        {
+            x = 0;
+            y = 0;
+            w = gfx->mWidth;
+            h = gfx->mHeight;
+        }
+        else
+        {
+            w = ((x + w + 7) & ~7) - (x & ~7);
+            x &= ~7;
+        }
+    }
+
+    rect.mX = x;
+    rect.mY = y;
+    rect.mWidth = w;
+    rect.mHeight = h;
+    gfx_add_dirty(gfx, rect);
+
+    return MRT_STATUS_OK;
+}
+
+mrt_status_t gfx_enable_tile_hash(gfx_t* gfx, int tileSize)
+{
+    free(gfx->mTileHash);
+    free(gfx->mTileState);
+    gfx->mTileHash = NULL;
+    gfx->mTileState = NULL;
+    gfx->mTileSize = 0;
+
+    if(tileSize <= 0)
+    {
+        return MRT_STATUS_OK;
+    }
+
+    if(gfx->mMode == GFX_COLOR_MODE_MONO)
+    {
+        //tiles are hashed as whole bytes, so rows have to start on byte boundaries
+        if(gfx->mWidth % 8)
+        {
+            return MRT_STATUS_ERROR;
+        }
+        tileSize = (tileSize + 7) & ~7;
+    }
+
+    gfx->mTileSize = tileSize;
+    gfx->mTileCols = (gfx->mWidth + tileSize - 1) / tileSize;
+    gfx->mTileRows = (gfx->mHeight + tileSize - 1) / tileSize;
+    gfx->mTileHash = (uint32_t*) malloc(gfx->mTileCols * gfx->mTileRows * sizeof(uint32_t));
+    gfx->mTileState = (uint8_t*) calloc(gfx->mTileCols * gfx->mTileRows, 1); //no hashes are valid until tiles have been sent
+
+    if((gfx->mTileHash == NULL) || (gfx->mTileState == NULL))
+    {
+        gfx_enable_tile_hash(gfx, 0);
+        return MRT_STATUS_ERROR;
+    }
+
+    return MRT_STATUS_OK;
+}
+
+mrt_status_t gfx_enable_glyph_cache(gfx_t* gfx, uint32_t budget)
+{
+    gfx_glyph_cache_t* cache = gfx->mGlyphCache;
+
+    if(cache != NULL)
+    {
+        for(int i=0; i < GFX_GLYPH_CACHE_SLOTS; i++)
+        {
+            free(cache->mEntries[i].mSpans);
+        }
+        free(cache->mBlock);
+        free(cache);
+        gfx->mGlyphCache = NULL;
+    }
+
+    if(budget == 0)
+    {
+        return MRT_STATUS_OK;
+    }
+
+    cache = (gfx_glyph_cache_t*) calloc(1, sizeof(gfx_glyph_cache_t));
+    if(cache == NULL)
+    {
+        return MRT_STATUS_ERROR;
+    }
+
+    for(int i=0; i < GFX_GLYPH_CACHE_SLOTS; i++)
+    {
+        cache->mBuckets[i] = -1;
+    }
+    cache->mBudget = budget;
+    gfx->mGlyphCache = cache;
+
+    return MRT_STATUS_OK;
+}
+
+mrt_status_t gfx_font_changed(gfx_t* gfx, const GFXfont* font)
+{
+    gfx_glyph_cache_t* cache = gfx->mGlyphCache;
+
+    //everything derived from a font is keyed on its address, which a reused struct keeps
+    if(cache != NULL)
+    {
+        for(int i=0; i < GFX_GLYPH_CACHE_SLOTS; i++)
+        {
+            if((cache->mEntries[i].mFont != NULL) && ((font == NULL) || (cache->mEntries[i].mFont == font)))
+            {
+                gfx_glyph_evict(cache, i);
+            }
+        }
+
+        if((font == NULL) || (cache->mBlockFont == font))
+        {
+            cache->mBlockFont = NULL;
+        }
+    }
+
+    if((font == NULL) || (gfx->mMetricsFont == font))
+    {
+        gfx->mMetricsFont = NULL;
+    }
+
+    return MRT_STATUS_OK;
+}
+
+mrt_status_t gfx_push_clip(gfx_t* gfx, int x, int y, int w, int h)
+{
+    if(gfx->mClipDepth >= GFX_CLIP_STACK_DEPTH)
+    {
+        return MRT_STATUS_ERROR;
+    }
+
+    gfx->mClipStack[gfx->mClipDepth++] = gfx->mClip;
+
+    //nested clips can only shrink the drawable region
+    if(!gfx_clip_rect(gfx, &x, &y, &w, &h))
+    {
+        x = gfx->mClip.mX;
+        y = gfx->mClip.mY;
+        w = 0;
+        h = 0;
+    }
+
+    gfx->mClip.mX = x;
+    gfx->mClip.mY = y;
+    gfx->mClip.mWidth = w;
+    gfx->mClip.mHeight = h;
+
+    return MRT_STATUS_OK;
+}
+
+mrt_status_t gfx_pop_clip(gfx_t* gfx)
+{
+    if(gfx->mClipDepth == 0)
+    {
+        return MRT_STATUS_ERROR;
+    }
+
+    gfx->mClip = gfx->mClipStack[--gfx->mClipDepth];
+
+    return MRT_STATUS_OK;
+}
+
+mrt_status_t gfx_clear_dirty(gfx_t* gfx)
+{
+    gfx->mDirtyCount = 0;
+    return MRT_STATUS_OK;
+}
+
+mrt_status_t gfx_set_dirty_merge(gfx_t* gfx, uint32_t threshold)
+{
+    gfx->mDirtyMerge = threshold;
+    return MRT_STATUS_OK;
+}
+
+/**
+ * @brief writes a row of pixels that are already in the canvas byte layout (see gfx_convert_span). Unflipped buffered
+ *        rows are a single memcpy
+ * @param pixels ptr to pixel data
+ * @param count number of pixels, already clipped
+ */
+static void gfx_write_row(gfx_t* gfx, int x, int y, const uint8_t* pixels, int count)
+{
+    uint8_t size = gfx_mode_bytes(gfx->mMode);
+    uint32_t packed;
+    int i;
+
+    if((gfx->fPlot != &gfx_plot_cb) && (gfx->mMode == GFX_COLOR_MODE_MONO) && (gfx->mXStep > 0))
+    {
+        gfx_copy_bits(gfx->mBuffer, GFX_PIXEL_INDEX(gfx, x, y), pixels, 0, count);
+        return;
+    }
+
+    if((gfx->fPlot == &gfx_plot_cb) || (gfx->mMode == GFX_COLOR_MODE_MONO))
+    {
+        for(i=0; i < count; i++)
+        {
+            packed = 0;
+            if(size)
+            {
+                memcpy(&packed, &pixels[i * size], size);
+            }
+            else if(pixels[i >> 3] & (0x80 >> (i & 7)))
+            {
+                packed = 0xFF;
+            }
+            gfx->fPlot(gfx, x + i, y, packed);
+        }
+        return;
+    }
+
+    uint8_t* dst = &gfx->mBuffer[gfx_span_index(gfx, x, y, count) * size];
+
+    if(gfx->mXStep > 0)
+    {
+        memcpy(dst, pixels, count * size);
+        return;
+    }
+
+    //horizontally flipped, the row is stored right to left
+    for(i=0; i < count; i++)
+    {
+        memcpy(&dst[(count - 1 - i) * size], &pixels[i * size], size);
+    }
+}
+
+/**
+ * @brief writes the set bits of one row of a 1 bit bitmap as spans. Source bytes that are all clear or all set are
+ *        handled whole, so only bytes on the edge of a run are walked bit by bit
+ * @param src ptr to bit stream
+ * @param srcBit bit offset of the first pixel
+ * @param count number of pixels
+ */
+static void gfx_blit_bit_runs(gfx_t* gfx, int x, int y, const uint8_t* src, uint32_t srcBit, int count, uint32_t color)
+{
+    int runStart = -1;
+
+    for(int i=0; i < count; i += 8)
+    {
+        int n = ((count - i) < 8) ? (count - i) : 8;
+        uint8_t bits = gfx_get_bits8(src, srcBit + i, count - i) & (uint8_t)(0xFF << (8 - n));
+
+        if(bits == 0xFF)
+        {
+            runStart = (runStart < 0) ? i : runStart;
+            continue;
+        }
+
+        if(bits == 0x00)
+        {
+            if(runStart >= 0)
+            {
+                gfx->fSpan(gfx, x + runStart, y, i - runStart, color);
+                runStart = -1;
+            }
+            continue;
+        }
+
+        for(int b=0; b < n; b++)
+        {
+            if(bits & (0x80 >> b))
+            {
+                runStart = (runStart < 0) ? (i + b) : runStart;
+            }
+            else if(runStart >= 0)
+            {
+                gfx->fSpan(gfx, x + runStart, y, (i + b) - runStart, color);
+                runStart = -1;
+            }
+        }
+    }
+
+    if(runStart >= 0)
+    {
+        gfx->fSpan(gfx, x + runStart, y, count - runStart, color);
+    }
+}
+
+/**
+ * @brief draws a bitmap without marking it dirty, so callers drawing many bitmaps can mark once
+ * @note 1 bit bitmaps are a continuous bit stream (rows are not padded to bytes), the same as font glyphs
+ */
+static void gfx_blit_bmp(gfx_t* gfx, int x, int y,const GFXBmp* bmp)
+{
+    uint32_t bmpIdx;
+    int i;
+
+    //crop to the rows and columns inside the clip rect
+    int col0 = (x < gfx->mClip.mX) ? (gfx->mClip.mX - x) : 0;
+    int row0 = (y < gfx->mClip.mY) ? (gfx->mClip.mY - y) : 0;
+    int col1 = (x + bmp->mWidth > GFX_CLIP_X1(gfx)) ? (GFX_CLIP_X1(gfx) - x) : bmp->mWidth;
+    int row1 = (y + bmp->mHeight > GFX_CLIP_Y1(gfx)) ? (GFX_CLIP_Y1(gfx) - y) : bmp->mHeight;
+
+    if((col0 >= col1) || (row0 >= row1))
+    {
+        return;
+    }
+
+    if( bmp->mMode == GFX_COLOR_MODE_MONO)
+    {
+        //On an unflipped MONO buffer, rows of the bitmap are merged straight into rows of the canvas with the pen raster op
+        bool direct = (gfx->mMode == GFX_COLOR_MODE_MONO) && (gfx->fPlot != &gfx_plot_cb) && (gfx->mXStep > 0);
+
+        for(i=row0; i < row1; i ++)
+        {
+            bmpIdx = ((uint32_t)i * bmp->mWidth) + col0;
+
+            if(direct)
+            {
+                gfx_merge_bits(gfx->mBuffer, GFX_PIXEL_INDEX(gfx, x + col0, y + i), bmp->mData, bmpIdx, col1 - col0,
+                               (uint8_t)gfx->mPen.mRopAnd, (uint8_t)gfx->mPen.mRopXor);
+            }
+            else
+            {
+                gfx_blit_bit_runs(gfx, x + col0, y + i, bmp->mData, bmpIdx, col1 - col0, gfx->mPen.mPacked);
+            }
+        }
+    }
+    else
+    {
+        uint8_t size = gfx_mode_bytes(bmp->mMode);
+        uint32_t stride = (uint32_t)bmp->mWidth * size;
+        uint8_t out[GFX_CONVERT_CHUNK * 4];
+
+        //Bitmaps with alpha are blended when the canvas can be read back
+        bool blend = ((bmp->mMode == GFX_COLOR_MODE_888A) || (bmp->mMode == GFX_COLOR_MODE_A888)) &&
+                     (gfx->fPlot != &gfx_plot_cb) && (gfx->mMode != GFX_COLOR_MODE_MONO);
+
+        for(i=row0; i < row1; i++)
+        {
+            const uint8_t* src = &bmp->mData[(i * stride) + (col0 * size)];
+
+            if(blend)
+            {
+                for(int a = col0; a < col1; a += GFX_CONVERT_CHUNK)
+                {
+                    int n = ((col1 - a) < GFX_CONVERT_CHUNK) ? (col1 - a) : GFX_CONVERT_CHUNK;
+
+                    gfx_convert_span(src, bmp->mMode, out, GFX_COLOR_MODE_888A, n);
+                    for(int k=0; k < n; k++)
+                    {
+                        gfx_blend_pixel(gfx, &gfx->mBuffer[GFX_PIXEL_INDEX(gfx, x + a + k, y + i) * gfx_mode_bytes(gfx->mMode)], &out[k * 4]);
+                    }
+                    src += n * size;
+                }
+                continue;
+            }
+
+            //Matching modes are copied straight from the bitmap
+            if(bmp->mMode == gfx->mMode)
+            {
+                gfx_write_row(gfx, x + col0, y + i, src, col1 - col0);
+                continue;
+            }
+
+            //Otherwise convert in batches
+            for(int a = col0; a < col1; a += GFX_CONVERT_CHUNK)
+            {
+                int n = ((col1 - a) < GFX_CONVERT_CHUNK) ? (col1 - a) : GFX_CONVERT_CHUNK;
+
+                gfx_convert_span(src, bmp->mMode, out, gfx->mMode, n);
+                gfx_write_row(gfx, x + a, y + i, out, n);
+                src += n * size;
+            }
+        }
+    }
+}
+
+mrt_status_t gfx_draw_bmp(gfx_t* gfx, int x, int y,const GFXBmp* bmp)
+{
+    gfx_blit_bmp(gfx, x, y, bmp);
+    gfx_mark_drawn(gfx, x, y, bmp->mWidth, bmp->mHeight);
+
+    return MRT_STATUS_OK;
+}
+
+/**
+ * @brief draws one glyph with the text cursor at (x,y), growing bounds by the area drawn
+ * @param glyphIdx index of the glyph in the font
+ * @param opt print options (GFX_OPT_OPAQUE)
+ * @param ascent distance from the baseline to the top of the line, used for opaque cells
+ * @param bounds min x, min y, max x, max y of everything drawn so far
+ */
+static void gfx_print_glyph(gfx_t* gfx, int x, int y, const GFXfont* font, uint16_t glyphIdx, uint32_t opt, int ascent, int* bounds)
+{
+    GFXglyph metrics;
+    const GFXglyph* glyph = &metrics;
+    gfx_glyph_entry_t* cached = NULL;
+    const uint8_t* data = NULL;
+    uint8_t scratch[GFX_GLYPH_SCRATCH_SIZE];
+    uint8_t* heap = NULL;
+    gfx_glyph_runs_t runs;
+    int x0, y0, w, h;
+
+    gfx_font_get_glyph(font, glyphIdx, &metrics);
+
+    if(opt & GFX_OPT_OPAQUE)
+    {
+        //the whole cell, background and glyph, is painted in one pass
+        x0 = x;
+        y0 = y - ascent;
+        w = glyph->mXOffset + glyph->mXAdvance;
+        h = font->mYAdvance;
+    }
+    else
+    {
+        x0 = x + glyph->mXOffset;
+        y0 = y + glyph->mYOffset;
+        w = glyph->mWidth;
+        h = glyph->mHeight;
     }
 
-    gfx->mMode = mode;
-    gfx->mBufferSize = ((width * height) * (gfx->mPixelSize)) / 8;
-    gfx->mBuffer = NULL;
-    gfx->mWidth = width;
-    gfx->mHeight = height;
-    gfx->mFont  = NULL;
-    if(write_cb == NULL)
+    //skip glyphs entirely outside of the clip rect
+    if((w <= 0) || (h <= 0) ||
+       (x0 >= GFX_CLIP_X1(gfx)) || (x0 + w <= gfx->mClip.mX) ||
+       (y0 >= GFX_CLIP_Y1(gfx)) || (y0 + h <= gfx->mClip.mY))
     {
-        gfx->fWritePixel = &gfx_write_pixel; 
+        return;
     }
-    else 
+
+    if(gfx->mGlyphCache != NULL)
     {
-        gfx->fWritePixel = write_cb;
+        cached = gfx_glyph_lookup(gfx->mGlyphCache, font, glyphIdx);
     }
-    gfx->fWriteBuffer = &gfx_write_buffer;
-    gfx->mDevice  = dev;
-    gfx->mBuffered = true;
-    gfx_set_pen(gfx,1,GFX_COLOR_WHITE);
 
-    return MRT_STATUS_OK;
-}
+    if(cached == NULL)
+    {
+        data = gfx_glyph_data(font, glyph, gfx->mGlyphCache, scratch, &heap);
+        if(data == NULL)
+        {
+            free(heap);
+            return;
+        }
+    }
 
+    gfx_glyph_runs_init(&runs, font, glyph, data, cached);
 
-mrt_status_t gfx_deinit(gfx_t* gfx)
-{
-    gfx->mBufferSize = 0;
-    gfx->mWidth =0;
-    gfx->mHeight = 0;
+    if(opt & GFX_OPT_OPAQUE)
+    {
+        gfx_print_cell(gfx, x, y, y0, h, glyph, &runs);
+    }
+    else if((cached != NULL) || (font->mFlags & GFX_FONT_RLE))
+    {
+        gfx_draw_glyph_runs(gfx, x0, y0, glyph, &runs);
+    }
+    else
+    {
+        GFXBmp bmp;
 
-  //if the gfx object manages its own buffer, free it from memory
-  if(gfx->mBuffered)
-  {
-    free(gfx->mBuffer);
-  }
+        //map glyph to a bitmap that we can draw
+        bmp.mData = data;
+        bmp.mWidth = glyph->mWidth;
+        bmp.mHeight = glyph->mHeight;
+        bmp.mMode = GFX_COLOR_MODE_MONO; //Font glyphs are all stored as monochromatic bitmaps
+        gfx_blit_bmp(gfx, x0, y0, &bmp);
+    }
 
-    return MRT_STATUS_OK;
+    free(heap);
+
+    bounds[0] = (x0 < bounds[0]) ? x0 : bounds[0];
+    bounds[1] = (y0 < bounds[1]) ? y0 : bounds[1];
+    bounds[2] = (x0 + w - 1 > bounds[2]) ? (x0 + w - 1) : bounds[2];
+    bounds[3] = (y0 + h - 1 > bounds[3]) ? (y0 + h - 1) : bounds[3];
 }
 
-mrt_status_t gfx_set_pen(gfx_t* gfx, uint32_t stroke, gfx_color_t color)
+/**
+ * @brief builds a text layout (see gfx_text_layout_init)
+ * @param gfx gfx_t whose computed font metrics are reused, or NULL to compute them for this layout
+ */
+static mrt_status_t gfx_text_layout_build(gfx_t* gfx, gfx_text_layout_t* layout, const GFXfont* font, const char* text, int wrapWidth, gfx_align_e align)
 {
-    gfx->mPen.mColor = color; 
-    gfx->mPen.mStroke = stroke;
-    gfx_convert_color(&gfx->mPen.mColor, gfx->mMode); //Convert color to match canvas mode
+    size_t len = strlen(text);
+    int lineX = 0;          //cursor x in the current line
+    int maxWidth = 0;
+    int gapItem = -1;       //first space of the last run of spaces in the line, where it can be wrapped
+    int gapX = 0;           //line width before that run of spaces
+    int wordItem = -1;      //first item after that run of spaces
+    gfx_text_line_t* line;
+    GFXmetrics scratch;
+    const GFXmetrics* metrics = gfx_font_metrics(gfx, font, &scratch);
 
-    return MRT_STATUS_OK;
-}
+    memset(layout, 0, sizeof(gfx_text_layout_t));
+    layout->mFont = font;
 
-mrt_status_t gfx_write_pixel(gfx_t* gfx, int x, int y, gfx_color_t* val)
-{
-    //If we are out of bounds, ignore
-    if(( x < 0) || (x >= gfx->mWidth) || (y < 0) || (y>= gfx->mHeight))
+    if(len >= UINT16_MAX)
     {
-        return MRT_STATUS_OK;
+        return MRT_STATUS_ERROR;
     }
 
-    if(gfx->mFlags & GFX_FLAG_HFLIP)
+    //every character is at most one glyph or one line break, so the string length bounds both arrays
+    layout->mItems = (gfx_text_item_t*) malloc((len ? len : 1) * sizeof(gfx_text_item_t));
+    layout->mLines = (gfx_text_line_t*) malloc((len + 1) * sizeof(gfx_text_line_t));
+    if((layout->mItems == NULL) || (layout->mLines == NULL))
     {
-       x = gfx->mWidth - x; 
+        gfx_text_layout_deinit(layout);
+        return MRT_STATUS_ERROR;
     }
 
-    if(gfx->mFlags & GFX_FLAG_VFLIP)
+    layout->mAscent = metrics->mAscent;
+    line = &layout->mLines[0];
+    line->mFirst = 0;
+    layout->mLineCount = 1;
+
+    while(*text != 0)
     {
-       y = gfx->mHeight - x; 
-    }
+        uint32_t c = gfx_utf8_next(&text);
+        bool space = (c == ' ');
+        bool wrap = false;
+        uint16_t glyphIdx;
+        int advance;
 
-    uint32_t cursor = ((y * gfx->mWidth) + x) * (gfx->mPixelSize / 8);
-    uint32_t byteOffset = (cursor  / 8);
-    uint8_t mask = 0x80;
+        if(c == '\n')
+        {
+            line->mCount = layout->mItemCount - line->mFirst;
+            line->mWidth = lineX;
+            line->mWrapped = false;
+            maxWidth = (lineX > maxWidth) ? lineX : maxWidth;
 
-    
-    if(gfx->mMode == GFX_COLOR_MODE_MONO)
-    {        
-        //get number of bits off of alignment in case we are not writing on a byte boundary
-        uint8_t bitOffset = cursor % 8;
-        mask = mask >> bitOffset;
+            line = &layout->mLines[layout->mLineCount++];
+            line->mFirst = layout->mItemCount;
+            lineX = 0;
+            gapItem = -1;
+            continue;
+        }
 
-        if( val->mData.mMonoData.on == 0)
+        if(!gfx_font_glyph(font, c, &glyphIdx))
         {
-            gfx->mBuffer[byteOffset] &= (~mask);
+            continue;
         }
-        else
+
+        advance = metrics->mFixedAdvance ? metrics->mFixedAdvance : gfx_font_advance(font, glyphIdx);
+
+        if((wrapWidth > 0) && (lineX > 0) && (lineX + advance > wrapWidth))
+        {
+            wrap = true;
+
+            if(space)
+            {
+                //wrap at this space, dropping it along with any spaces right before it
+                if((gapItem >= 0) && (wordItem == layout->mItemCount))
+                {
+                    layout->mItemCount = gapItem;
+                    lineX = gapX;
+                }
+            }
+            else if((gapItem > line->mFirst) && (wordItem > gapItem))
+            {
+                //wrap at the last run of spaces. Only the word after it is moved, so each item moves at most once
+                int count = layout->mItemCount - wordItem;
+                int shift = (count > 0) ? layout->mItems[wordItem].mX : lineX;
+
+                memmove(&layout->mItems[gapItem], &layout->mItems[wordItem], count * sizeof(gfx_text_item_t));
+                layout->mItemCount = gapItem + count;
+
+                line->mCount = gapItem - line->mFirst;
+                line->mWidth = gapX;
+                line->mWrapped = true;
+                maxWidth = (gapX > maxWidth) ? gapX : maxWidth;
+
+                line = &layout->mLines[layout->mLineCount++];
+                line->mFirst = gapItem;
+                for(int i = gapItem; i < layout->mItemCount; i++)
+                {
+                    layout->mItems[i].mX -= shift;
+                    layout->mItems[i].mY += font->mYAdvance;
+                }
+                lineX -= shift;
+                gapItem = -1;
+
+                //the glyph still goes on the new line, unless the word is too long for it
+                wrap = (lineX > 0) && (lineX + advance > wrapWidth);
+            }
+        }
+
+        if(wrap)
         {
-            gfx->mBuffer[byteOffset] |= mask;
+            line->mCount = layout->mItemCount - line->mFirst;
+            line->mWidth = lineX;
+            line->mWrapped = true;
+            maxWidth = (lineX > maxWidth) ? lineX : maxWidth;
+
+            line = &layout->mLines[layout->mLineCount++];
+            line->mFirst = layout->mItemCount;
+            lineX = 0;
+            gapItem = -1;
+
+            if(space)
+            {
+                continue;
+            }
         }
 
-    }
-    else 
-    {
-        memcpy(&gfx->mBuffer[cursor], &val->mData, (gfx->mPixelSize / 8));
-    }
+        //spaces are not drawn at the start of wrapped lines
+        if(space && (lineX == 0) && (layout->mLineCount > 1) && layout->mLines[layout->mLineCount - 2].mWrapped &&
+           (layout->mItemCount == line->mFirst))
+        {
+            continue;
+        }
 
-    return MRT_STATUS_OK;
-}
+        if(space)
+        {
+            if((gapItem < 0) || (wordItem != layout->mItemCount))
+            {
+                gapItem = layout->mItemCount;
+                gapX = lineX;
+            }
+            wordItem = layout->mItemCount + 1;
+        }
 
-mrt_status_t gfx_write_buffer(gfx_t* gfx, int x, int y, uint8_t* data, int len, uint32_t opt)
-{
-    return MRT_STATUS_NOT_IMPLEMENTED;
-}
+        gfx_text_item_t* item = &layout->mItems[layout->mItemCount++];
 
-mrt_status_t gfx_refresh(gfx_t* gfx)
-{
-    return gfx->fWriteBuffer(gfx, 0,0,gfx->mBuffer, gfx->mBufferSize, true);
-}
+        item->mGlyph = (font->mFlags & GFX_FONT_PACKED) ? NULL : &font->mGlyph[glyphIdx];
+        item->mIndex = glyphIdx;
+        item->mX = lineX;
+        item->mY = (layout->mLineCount - 1) * font->mYAdvance;
+        lineX += advance;
+    }
 
-mrt_status_t gfx_draw_bmp(gfx_t* gfx, int x, int y,const GFXBmp* bmp)
-{
-    uint32_t bmpIdx = 0;
-    uint8_t mask =0x80;
-    int bit =0;
-    int i,a;
+    line->mCount = layout->mItemCount - line->mFirst;
+    line->mWidth = lineX;
+    line->mWrapped = false;
+    maxWidth = (lineX > maxWidth) ? lineX : maxWidth;
 
-    if( bmp->mMode == GFX_COLOR_MODE_MONO)
+    //spaces are found by glyph when justifying
+    uint16_t spaceIdx;
+    bool hasSpace = gfx_font_glyph(font, ' ', &spaceIdx);
+
+    layout->mBounds.mWidth = (wrapWidth > 0) ? wrapWidth : maxWidth;
+    layout->mBounds.mHeight = (maxWidth > 0) ? (layout->mLineCount * font->mYAdvance) : 0;
+
+    //positions are aligned once here, so drawing is a straight walk over the items
+    for(int i=0; (align != GFX_ALIGN_LEFT) && (i < layout->mLineCount); i++)
     {
+        line = &layout->mLines[i];
+        int extra = layout->mBounds.mWidth - line->mWidth;
+        int shift = (align == GFX_ALIGN_RIGHT) ? extra : (align == GFX_ALIGN_CENTER) ? (extra / 2) : 0;
+        int spaces = 0;
+        int gap = 0;
+
+        if((align == GFX_ALIGN_JUSTIFY) && hasSpace && line->mWrapped && (extra > 0))
+        {
+            for(int j = line->mFirst; j < line->mFirst + line->mCount; j++)
+            {
+                spaces += (layout->mItems[j].mIndex == spaceIdx);
+            }
+        }
 
-        for(i=0; i < bmp->mHeight; i ++)
+        for(int j = line->mFirst; j < line->mFirst + line->mCount; j++)
         {
-            for(a=0; a < bmp->mWidth; a++)
+            //the extra width is spread over the spaces, each glyph after a space moves by its share
+            if((spaces > 0) && (layout->mItems[j].mIndex == spaceIdx))
             {
-            if(((bmp->mData[bmpIdx/8] << bit) & mask))
-                gfx->fWritePixel(gfx, x+a, y+i, &gfx->mPen.mColor);
-            bmpIdx ++;
-            bit++;
-            if(bit == 8)
-                bit =0;
+                gap++;
+                shift = (extra * gap) / spaces;
             }
 
+            layout->mItems[j].mX += shift;
         }
     }
 
-    //TODO implement bitmap drawing for other color modes
-
     return MRT_STATUS_OK;
 }
 
@@ -325,24 +4822,41 @@ gfx_rect_t gfx_get_print_size(gfx_t* gfx, const char* text, uint32_t opt)
         return ret;
     }
 
-    char c = *text++;   //grab first character from string
+    //wrapped or aligned text is measured from the same layout gfx_print would draw (as if printed at x = 0)
+    if(opt & (GFX_OPT_WRAP | GFX_OPT_ALIGN_MASK))
+    {
+        gfx_text_layout_t layout;
+        int wrapWidth = (gfx->mWidth > 1) ? gfx->mWidth : 1;
+
+        if(gfx_text_layout_build(gfx, &layout, gfx->mFont, text, (opt & GFX_OPT_WRAP) ? wrapWidth : 0, (gfx_align_e)((opt & GFX_OPT_ALIGN_MASK) >> 4)) == MRT_STATUS_OK)
+        {
+            ret = layout.mBounds;
+            gfx_text_layout_deinit(&layout);
+        }
+
+        return ret;
+    }
+
+    uint32_t c;
+    uint16_t glyphIdx;
     int lineCount =1; 
-    GFXglyph* glyph;    //pointer to glyph for current character
+    int fixed = gfx_font_metrics(gfx, gfx->mFont, NULL)->mFixedAdvance; //monospace fonts only need a glyph count
 
-    int xx;
+    int xx = 0;
     int maxX =0;
     
-    while(c != 0)
+    while(*text != 0)
     {
+        c = gfx_utf8_next(&text);
+
         if(c == '\n')
         {
             lineCount++;
             xx = 0;
         }
-        else if((c >= gfx->mFont->mFirst) && (c <= gfx->mFont->mLast))// make sure the font contains this character
+        else if(gfx_font_glyph(gfx->mFont, c, &glyphIdx))// make sure the font contains this character
         {
-
-            xx += glyph->mXOffset + glyph->mXAdvance;
+            xx += fixed ? fixed : gfx_font_advance(gfx->mFont, glyphIdx);
 
             if(xx > maxX)
             {
@@ -350,9 +4864,6 @@ gfx_rect_t gfx_get_print_size(gfx_t* gfx, const char* text, uint32_t opt)
             }
 
         }
-
-        //get next character
-        c = *text++;
     }
 
     if(maxX > 0)
@@ -364,6 +4875,18 @@ gfx_rect_t gfx_get_print_size(gfx_t* gfx, const char* text, uint32_t opt)
     return ret; 
 }
 
+mrt_status_t gfx_get_font_metrics(gfx_t* gfx, GFXmetrics* metrics)
+{
+    if(gfx->mFont == NULL)
+    {
+        return MRT_STATUS_ERROR;
+    }
+
+    *metrics = *gfx_font_metrics(gfx, gfx->mFont, NULL);
+
+    return MRT_STATUS_OK;
+}
+
 
 mrt_status_t gfx_print(gfx_t* gfx, int x, int y, const char * text, uint32_t opt)
 {
@@ -372,134 +4895,294 @@ mrt_status_t gfx_print(gfx_t* gfx, int x, int y, const char * text, uint32_t opt
     return MRT_STATUS_ERROR;
 
 
+  //wrapped or aligned text needs its line breaks first, which the layout finds in one pass
+  if(opt & (GFX_OPT_WRAP | GFX_OPT_ALIGN_MASK))
+  {
+    gfx_text_layout_t layout;
+    int wrapWidth = (gfx->mWidth - x > 1) ? (gfx->mWidth - x) : 1;
+
+    if(gfx_text_layout_build(gfx, &layout, gfx->mFont, text, (opt & GFX_OPT_WRAP) ? wrapWidth : 0, (gfx_align_e)((opt & GFX_OPT_ALIGN_MASK) >> 4)) != MRT_STATUS_OK)
+    {
+      return MRT_STATUS_ERROR;
+    }
+
+    gfx_draw_text_layout(gfx, x, y, &layout, opt);
+    gfx_text_layout_deinit(&layout);
+
+    return MRT_STATUS_OK;
+  }
+
   int xx =x;     //current position for writing
   int yy = y;
-  GFXglyph* glyph;    //pointer to glyph for current character
-  GFXBmp bmp;         //bitmap struct used to draw glyph
-  char c = *text++;   //grab first character from string
+  uint32_t c;         //current codepoint
+  uint16_t glyphIdx;  //index of its glyph in the font
+  int bounds[4] = {INT_MAX, INT_MAX, INT_MIN, INT_MIN}; //bounds of everything drawn, marked dirty once at the end
+  const GFXmetrics* metrics = gfx_font_metrics(gfx, gfx->mFont, NULL);
+  int ascent = (opt & GFX_OPT_OPAQUE) ? metrics->mAscent : 0; //opaque cells span the whole line
+  int fixed = metrics->mFixedAdvance;
 
   //run until we hit a null character (end of string)
-  while(c != 0)
+  while(*text != 0)
   {
+    c = gfx_utf8_next(&text);
+
     if(c == '\n')
     {
       //if character is newline, we advance the y, and reset x
       yy+= gfx->mFont->mYAdvance;
       xx = x;
     }
-    else if((c >= gfx->mFont->mFirst) && (c <= gfx->mFont->mLast))// make sure the font contains this character
+    else if(gfx_font_glyph(gfx->mFont, c, &glyphIdx))// make sure the font contains this character
     {
-      //grab the glyph for current character from our font
-      glyph = &gfx->mFont->mGlyph[c - gfx->mFont->mFirst]; //index in glyph array is offset by first printable char in font
+      gfx_print_glyph(gfx, xx, yy, gfx->mFont, glyphIdx, opt, ascent, bounds);
+      xx += fixed ? fixed : gfx_font_advance(gfx->mFont, glyphIdx);
+    }
+  }
 
-      //map glyph to a bitmap that we can draw
-      bmp.mData = &gfx->mFont->mBitmap[glyph->mOffset];
-      bmp.mWidth = glyph->mWidth ;
-      bmp.mHeight = glyph->mHeight ;
-      bmp.mMode = GFX_COLOR_MODE_MONO; //Font glyphs are all stored as monochromatic bitmaps
+  if(bounds[2] >= bounds[0])
+  {
+    gfx_mark_dirty_bounds(gfx, bounds[0], bounds[1], bounds[2], bounds[3]);
+  }
 
-			//If glyph would overrun and wrap is enabled, move to next line
-			//TODO update this to find word bounds instead of character
-      if((opt & GFX_OPT_WRAP) && ( xx+glyph->mXOffset+ glyph->mXAdvance > gfx->mWidth))
-      {
-				//if character is newline, we advance the y, and reset x
-				yy+= gfx->mFont->mYAdvance;
-				xx = x;
-      }
+    return MRT_STATUS_OK;
+}
 
-      //draw the character
-      gfx_draw_bmp(gfx, xx+glyph->mXOffset , yy+ glyph->mYOffset , &bmp );
-      xx += glyph->mXOffset + glyph->mXAdvance;
-    }
+mrt_status_t gfx_text_layout_init(gfx_text_layout_t* layout, const GFXfont* font, const char* text, int wrapWidth, gfx_align_e align)
+{
+    return gfx_text_layout_build(NULL, layout, font, text, wrapWidth, align);
+}
 
+mrt_status_t gfx_text_layout_deinit(gfx_text_layout_t* layout)
+{
+    free(layout->mItems);
+    free(layout->mLines);
+    layout->mItems = NULL;
+    layout->mLines = NULL;
+    layout->mItemCount = 0;
+    layout->mLineCount = 0;
 
-    //get next character
-    c = *text++;
-  }
     return MRT_STATUS_OK;
 }
 
-mrt_status_t gfx_draw_line(gfx_t* gfx, int x0, int y0, int x1, int y1)
+mrt_status_t gfx_draw_text_layout(gfx_t* gfx, int x, int y, const gfx_text_layout_t* layout, uint32_t opt)
 {
-    int16_t steep = abs(y1 - y0) > abs(x1 - x0);
-    if (steep) {
-        _swap_int(x0, y0);
-        _swap_int(x1, y1);
+    int bounds[4] = {INT_MAX, INT_MAX, INT_MIN, INT_MIN}; //bounds of everything drawn, marked dirty once at the end
+
+    for(int i=0; i < layout->mItemCount; i++)
+    {
+        const gfx_text_item_t* item = &layout->mItems[i];
+
+        gfx_print_glyph(gfx, x + item->mX, y + item->mY, layout->mFont, item->mIndex, opt, layout->mAscent, bounds);
     }
 
-    if (x0 > x1) {
-        _swap_int(x0, x1);
-        _swap_int(y0, y1);
+    if(bounds[2] >= bounds[0])
+    {
+        gfx_mark_dirty_bounds(gfx, bounds[0], bounds[1], bounds[2], bounds[3]);
     }
 
-    int16_t dx, dy;
-    dx = x1 - x0;
-    dy = abs(y1 - y0);
+    return MRT_STATUS_OK;
+}
+
+mrt_status_t gfx_draw_line(gfx_t* gfx, int x0, int y0, int x1, int y1)
+{
+    int pad = gfx->mPen.mStroke / 2;
+
+    gfx_mark_dirty_bounds(gfx, (int64_t)((x0 < x1) ? x0 : x1) - pad, (int64_t)((y0 < y1) ? y0 : y1) - pad, (int64_t)((x0 > x1) ? x0 : x1) + pad, (int64_t)((y0 > y1) ? y0 : y1) + pad);
+    gfx_stroke_line(gfx, x0, y0, x1, y1, gfx->mPen.mStroke, gfx->mPen.mPacked);
+
+    return MRT_STATUS_OK;
+}
 
-    int16_t err = dx / 2;
-    int16_t ystep;
+mrt_status_t gfx_draw_rect(gfx_t* gfx, int x, int y, int w, int h, uint32_t opt)
+{
 
-    if (y0 < y1) {
-        ystep = 1;
-    } else {
-        ystep = -1;
+    if(opt & GFX_OPT_FILL)
+    {
+        gfx_fill_rect(gfx, x, y, w, h, gfx->mPen.mPacked);
     }
+    else 
+    {
+        //Outline is drawn inside the rect, as four filled bands
+        int stroke = (gfx->mPen.mStroke > 0) ? gfx->mPen.mStroke : 1;
+        int64_t x1 = (int64_t)x + w;
+        int64_t y1 = (int64_t)y + h;
 
-    for (; x0<=x1; x0++) {
-        if (steep) {
-            gfx->fWritePixel(gfx,y0, x0, &gfx->mPen.mColor);
-        } else {
-            gfx->fWritePixel(gfx, x0, y0, &gfx->mPen.mColor);
+        //far edges are pulled in to just outside of the clip rect, where their bands are not visible anyway, so the band
+        //coords can not overflow
+        x = (x < gfx->mClip.mX - stroke) ? (gfx->mClip.mX - stroke) : x;
+        y = (y < gfx->mClip.mY - stroke) ? (gfx->mClip.mY - stroke) : y;
+        x1 = (x1 > GFX_CLIP_X1(gfx) + stroke) ? (GFX_CLIP_X1(gfx) + stroke) : x1;
+        y1 = (y1 > GFX_CLIP_Y1(gfx) + stroke) ? (GFX_CLIP_Y1(gfx) + stroke) : y1;
+        w = (x1 > x) ? (int)(x1 - x) : 0;
+        h = (y1 > y) ? (int)(y1 - y) : 0;
+
+        if((2 * stroke >= w) || (2 * stroke >= h))
+        {
+            gfx_fill_rect(gfx, x, y, w, h, gfx->mPen.mPacked);
         }
-        err -= dy;
-        if (err < 0) {
-            y0 += ystep;
-            err += dx;
+        else
+        {
+            gfx_fill_rect(gfx, x, y, w, stroke, gfx->mPen.mPacked);
+            gfx_fill_rect(gfx, x, y + h - stroke, w, stroke, gfx->mPen.mPacked);
+            gfx_fill_rect(gfx, x, y + stroke, stroke, h - (2 * stroke), gfx->mPen.mPacked);
+            gfx_fill_rect(gfx, x + w - stroke, y + stroke, stroke, h - (2 * stroke), gfx->mPen.mPacked);
         }
     }
 
+    gfx_mark_drawn(gfx, x, y, w, h);
+    return MRT_STATUS_OK;
+}
+
+mrt_status_t gfx_draw_circle(gfx_t* gfx, int x, int y, int r, uint32_t opt)
+{
+    int stroke = gfx->mPen.mStroke;
+
+    //inside tests square the squared radius, which only fits in 64 bits up to GFX_MAX_RADIUS
+    if((r < 0) || (r > GFX_MAX_RADIUS))
+    {
+        return MRT_STATUS_ERROR;
+    }
+
+    if(!gfx_radius_on_canvas(gfx, x, y, r, r))
+    {
+        return MRT_STATUS_OK;
+    }
+
+    if(opt & GFX_OPT_FILL)
+    {
+        gfx_circle_fill(gfx, x, y, r, gfx->mPen.mPacked);
+    }
+    else if(stroke > 1)
+    {
+        gfx_fill_ellipse_band(gfx, x, y, r, r, stroke, NULL, gfx->mPen.mPacked);
+    }
+    else
+    {
+        gfx_circle_outline(gfx, x, y, r, NULL, gfx->mPen.mPacked);
+    }
 
+    gfx_mark_drawn(gfx, x - r, y - r, (2 * r) + 1, (2 * r) + 1);
     return MRT_STATUS_OK;
 }
 
-mrt_status_t gfx_draw_rect(gfx_t* gfx, int x, int y, int w, int h, uint32_t opt)
+mrt_status_t gfx_draw_ellipse(gfx_t* gfx, int x, int y, int rx, int ry, uint32_t opt)
 {
+    int stroke = gfx->mPen.mStroke;
+
+    if((rx < 0) || (ry < 0) || (rx > GFX_MAX_RADIUS) || (ry > GFX_MAX_RADIUS))
+    {
+        return MRT_STATUS_ERROR;
+    }
+
+    if(!gfx_radius_on_canvas(gfx, x, y, rx, ry))
+    {
+        return MRT_STATUS_OK;
+    }
 
     if(opt & GFX_OPT_FILL)
     {
-        for(int i=0; i < h; i++)
-        {
-            for(int a=0; a < w; a++)
-            {
-                gfx->fWritePixel(gfx,x+a, y+i, &gfx->mPen.mColor);
-            }
-        }
+        gfx_ellipse_midpoint(gfx, x, y, rx, ry, true, gfx->mPen.mPacked);
     }
-    else 
+    else if(stroke > 1)
+    {
+        gfx_fill_ellipse_band(gfx, x, y, rx, ry, stroke, NULL, gfx->mPen.mPacked);
+    }
+    else
     {
-        //TODO
+        gfx_ellipse_midpoint(gfx, x, y, rx, ry, false, gfx->mPen.mPacked);
     }
+
+    gfx_mark_drawn(gfx, x - rx, y - ry, (2 * rx) + 1, (2 * ry) + 1);
     return MRT_STATUS_OK;
 }
 
-mrt_status_t gfx_draw_circle(gfx_t* gfx, int x, int y, int r, uint32_t opt)
+mrt_status_t gfx_draw_arc(gfx_t* gfx, int x, int y, int r, int start, int end, uint32_t opt)
 {
+    int stroke = gfx->mPen.mStroke;
+    gfx_sector_t sector;
+
+    if((r < 0) || (r > GFX_MAX_RADIUS))
+    {
+        return MRT_STATUS_ERROR;
+    }
+
+    if(!gfx_radius_on_canvas(gfx, x, y, r, r))
+    {
+        return MRT_STATUS_OK;
+    }
+
+    gfx_sector_init(&sector, start, end);
+
+    if(opt & GFX_OPT_FILL)
+    {
+        gfx_fill_ellipse_band(gfx, x, y, r, r, 0, &sector, gfx->mPen.mPacked);
+    }
+    else if(stroke > 1)
+    {
+        gfx_fill_ellipse_band(gfx, x, y, r, r, stroke, &sector, gfx->mPen.mPacked);
+    }
+    else
+    {
+        gfx_circle_outline(gfx, x, y, r, &sector, gfx->mPen.mPacked);
+    }
 
-    //TODO
+    gfx_mark_drawn(gfx, x - r, y - r, (2 * r) + 1, (2 * r) + 1);
     return MRT_STATUS_OK;
 }
 
-mrt_status_t gfx_fill(gfx_t* gfx, gfx_color_t val)
+mrt_status_t gfx_draw_polygon(gfx_t* gfx, const gfx_point_t* points, int count, uint32_t opt)
 {
-    gfx_convert_color(&val, gfx->mMode);
-    for(int y = 0; y < gfx->mHeight; y++)
+    if(opt & GFX_OPT_FILL)
+    {
+        return gfx_fill_polygon(gfx, points, count, opt);
+    }
+
+    if(count < 2)
+    {
+        return MRT_STATUS_ERROR;
+    }
+
+    mrt_status_t status = MRT_STATUS_OK;
+
+    if(gfx->mPen.mStroke > 1)
+    {
+        status = gfx_stroke_polygon(gfx, points, count, gfx->mPen.mStroke, gfx->mPen.mPacked);
+    }
+    else if(count == 2)
+    {
+        gfx_write_line(gfx, points[0].mX, points[0].mY, points[1].mX, points[1].mY, true, gfx->mPen.mPacked);
+    }
+    else
     {
-        for(int x = 0; x < gfx->mWidth; x++)
+        //each side leaves out its last pixel, which is the first pixel of the next side
+        for(int i=0; i < count; i++)
         {
-            gfx_write_pixel(gfx,x,y,&val);
+            const gfx_point_t* p0 = &points[i];
+            const gfx_point_t* p1 = &points[(i + 1) % count];
+
+            gfx_write_line(gfx, p0->mX, p0->mY, p1->mX, p1->mY, false, gfx->mPen.mPacked);
         }
     }
-    
+
+    gfx_mark_dirty_points(gfx, points, count, gfx->mPen.mStroke / 2);
+    return status;
+}
+
+mrt_status_t gfx_fill_polygon(gfx_t* gfx, const gfx_point_t* points, int count, uint32_t opt)
+{
+    mrt_status_t status = gfx_scan_polygon(gfx, points, count, (opt & GFX_OPT_NONZERO), gfx->mPen.mPacked);
+
+    gfx_mark_dirty_points(gfx, points, count, 0);
+    return status;
+}
+
+mrt_status_t gfx_fill(gfx_t* gfx, gfx_color_t val)
+{
+    //explicit colors are stored as is, even if the pen blends
+    gfx_convert_color(&val, gfx->mMode);
+    gfx_fill_rect_span(gfx, gfx_plain_span(gfx), 0, 0, gfx->mWidth, gfx->mHeight, gfx_pack_color(gfx->mMode, &val));
+    gfx_mark_drawn(gfx, 0, 0, gfx->mWidth, gfx->mHeight);
+
     return MRT_STATUS_OK;
 }
 
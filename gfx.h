@@ -19,15 +19,64 @@
 #define GFX_FLAG_NONE  0x00000000
 #define GFX_FLAG_HFLIP 0x00010000
 #define GFX_FLAG_VFLIP 0x00020000
+#define GFX_FLAG_PARTIAL_REFRESH 0x00040000 //gfx_refresh only flushes regions that changed since the last refresh
+#define GFX_FLAG_PREMULTIPLIED 0x00080000 //888A/A888 buffer colors are premultiplied by alpha (faster blending)
 
 #define GFX_OPT_NONE  0x00000000
 #define GFX_OPT_FILL 0x000000001 //Fill in primitive shape 
-#define GFX_OPT_WRAP 0x000000002 // Wrap text
+#define GFX_OPT_WRAP 0x000000002 // Wrap text at word bounds (characters if a word is too long for the line)
+#define GFX_OPT_NONZERO 0x000000004 // Use the nonzero winding rule for polygon fills (default is even-odd)
+#define GFX_OPT_OPAQUE 0x000000008 // Paint the background of each text cell with the background color
+#define GFX_OPT_ALIGN_CENTER 0x000000010 // Center lines of text
+#define GFX_OPT_ALIGN_RIGHT 0x000000020 // Right align lines of text
+#define GFX_OPT_ALIGN_JUSTIFY 0x000000030 // Justify wrapped lines of text
+#define GFX_OPT_ALIGN_MASK 0x000000030 // Alignment bits of the options, (opt & GFX_OPT_ALIGN_MASK) >> 4 is a gfx_align_e
+
+#ifndef GFX_DIRTY_RECT_COUNT
+#define GFX_DIRTY_RECT_COUNT 8      //Max number of separate dirty regions tracked between refreshes
+#endif
+
+#ifndef GFX_DIRTY_MERGE_DEFAULT
+#define GFX_DIRTY_MERGE_DEFAULT 256 //Default merge threshold (in pixels) for dirty regions
+#endif
+
+#define GFX_MAX_RADIUS 32767        //Largest radius of circles, ellipses and arcs (their inside tests use r^4 in 64 bits)
+
+#ifndef GFX_GLYPH_CACHE_SLOTS
+#define GFX_GLYPH_CACHE_SLOTS 64    //Max number of glyphs held by the glyph cache
+#endif
+
+#ifndef GFX_GLYPH_SCRATCH_SIZE
+#define GFX_GLYPH_SCRATCH_SIZE 512  //Stack bytes for decompressing LZ font glyphs without a glyph cache, more are allocated
+#endif
+
+#ifndef GFX_CLIP_STACK_DEPTH
+#define GFX_CLIP_STACK_DEPTH 4      //Max number of nested clip rects
+#endif
+
+#ifndef GFX_SCAN_STACK_EDGES
+#define GFX_SCAN_STACK_EDGES 32     //Polygon edges held on the stack while filling, larger polygons allocate
+#endif
 
 /* Exported types ------------------------------------------------------------*/
 
 struct gfx_struct;
 
+typedef enum{
+  GFX_ROP_COPY,                 //Pen color replaces the pixel
+  GFX_ROP_XOR,                  //Pixel is XORed with the pen color
+  GFX_ROP_INVERT,               //Pixel is inverted, pen color is ignored
+  GFX_ROP_AND,                  //Pixel is ANDed with the pen color
+  GFX_ROP_OR                    //Pixel is ORed with the pen color
+}gfx_rop_e;
+
+typedef enum{
+  GFX_ALIGN_LEFT = 0,           //Lines start at the left of the text box
+  GFX_ALIGN_CENTER,             //Lines are centered in the text box
+  GFX_ALIGN_RIGHT,              //Lines end at the right of the text box
+  GFX_ALIGN_JUSTIFY             //Spaces in wrapped lines are stretched to fill the text box. Other lines are left aligned
+}gfx_align_e;
+
 typedef enum{
   GFX_COLOR_MODE_MONO,          //Monochromatic color mode
   GFX_COLOR_MODE_565,           //16bit color mode using 565 format
@@ -86,12 +135,14 @@ typedef struct{
 typedef mrt_status_t (*f_gfx_write_pixel)(struct gfx_struct* gfx, int x, int y, gfx_color_t* color);           
 typedef mrt_status_t (*f_gfx_write)(struct gfx_struct* gfx, int x, int y, uint8_t* data, int len, bool wrap); //pointer to write function
 typedef mrt_status_t (*f_gfx_read)(struct gfx_struct* gfx, int x, int y, uint8_t* data, int len, bool wrap); //pointer to read function
+typedef void (*f_gfx_plot)(struct gfx_struct* gfx, int x, int y, uint32_t color);            //writes one pre-clipped pixel of packed canvas color
+typedef void (*f_gfx_span)(struct gfx_struct* gfx, int x, int y, int len, uint32_t color);   //writes a pre-clipped horizontal run of packed canvas color
 
 /**
  * @brief Color bitmap struct used to store and display images
  */
 typedef struct{
-	const uint8_t* mData;         //Data for bitmap
+	const uint8_t* mData;         //Data for bitmap. MONO is a continuous bit stream, color modes use the canvas byte layout
 	int mWidth;                   //Width (in pixels)
 	int mHeight;                  //Hieght (in pixels)
   gfx_color_mode_e mMode;       //Color mode of data
@@ -107,14 +158,72 @@ typedef struct {                // Data stored PER GLYPH
 	int8_t   mXOffset, mYOffset;  // Dist from cursor pos to UL corner
 } GFXglyph;
 
+/**
+ * @brief glyph metrics packed in 8 bytes, for fonts with GFX_FONT_PACKED (glyph data up to 64K)
+ */
+typedef struct {
+	uint16_t mOffset;             // Offset into GFXfont->mBitmap
+	uint8_t  mWidth, mHeight;     // Bitmap dimensions in pixels
+	uint8_t  mXAdvance;           // Distance to advance cursor (x axis)
+	int8_t   mXOffset, mYOffset;  // Dist from cursor pos to UL corner
+} GFXpackedGlyph;
+
+/**
+ * @brief a run of consecutive codepoints in a font with sparse glyph ranges
+ */
+typedef struct {
+	uint32_t mFirst;          // First codepoint in the range
+	uint16_t mCount;          // Number of codepoints in the range
+	uint16_t mGlyph;          // Index in GFXfont->mGlyph of the glyph for mFirst
+} GFXrange;
+
+/**
+ * @brief a compressed block of glyph data in a font with GFX_FONT_LZ. Glyphs never cross blocks
+ */
+typedef struct {
+	uint32_t mOffset;         // Offset of the compressed block in GFXfont->mBitmap
+	uint32_t mStart;          // Offset of the block's first byte in the uncompressed glyph data (GFXglyph->mOffset)
+} GFXblock;
+
+/**
+ * @brief font wide metrics, stored with the font by fontconvert or computed the first time a font is used
+ */
+typedef struct {
+	int8_t   mAscent;         // Rows from the top of the tallest glyph down to the baseline (y passed to gfx_print)
+	int8_t   mDescent;        // Rows from the baseline down to below the lowest glyph. The ink of a line is ascent + descent tall
+	uint8_t  mMaxAdvance;     // Widest cursor advance
+	uint8_t  mAvgAdvance;     // Average cursor advance
+	uint8_t  mFixedAdvance;   // Cursor advance of every glyph in monospace fonts, 0 for proportional fonts
+} GFXmetrics;
+
+#define GFX_FONT_RLE 0x01     // Glyph bitmaps are run length encoded (see GFXfont)
+#define GFX_FONT_LZ 0x02      // Glyph data is compressed in LZ4 blocks (see GFXfont)
+#define GFX_FONT_PACKED 0x04  // GFXfont->mGlyph points to GFXpackedGlyph entries
+
 /**
  * @brief Font data
+ * @note Fields after mYAdvance are optional and zero when a font does not use them. The bundled fonts and fontconvert
+ *       output set every field, so they build cleanly with -Wmissing-field-initializers
+ *       With GFX_FONT_RLE, each glyph bitmap is a list of run lengths (one byte each) over its width*height pixels in
+ *       row order, alternating clear and set and starting with clear. Runs may cross rows. Runs over 255 pixels are
+ *       split with a zero length run of the other kind between the pieces
+ *       With GFX_FONT_LZ, the glyph data (bitmaps or RLE) is split into blocks at glyph bounds, and each block is
+ *       compressed in the LZ4 block format. mBlocks has mBlockCount + 1 entries, the last one marking the end of both
+ *       the compressed and the uncompressed data. Blocks are decompressed on demand, and the glyph cache keeps the
+ *       glyphs drawn from them (see gfx_enable_glyph_cache)
  */
 typedef struct { // Data stored for FONT AS A WHOLE:
 	uint8_t  *mBitmap;        // Glyph bitmaps, concatenated
 	GFXglyph *mGlyph;         // Glyph array
-	uint8_t   mFirst, mLast;  // ASCII extents
+	uint8_t   mFirst, mLast;  // ASCII extents, used when there is no range table
 	uint8_t   mYAdvance;      // Newline distance (y axis)
+	const GFXrange* mRanges;  // Codepoint ranges sorted by mFirst, or NULL if the font covers mFirst..mLast
+	uint16_t  mRangeCount;    // Number of ranges
+	uint8_t   mFlags;         // GFX_FONT_x flags
+	const GFXblock* mBlocks;  // Compressed blocks, sorted (GFX_FONT_LZ only)
+	uint16_t  mBlockCount;    // Number of compressed blocks
+	const uint8_t* mAdvance;  // Optional cursor advance (xOffset + xAdvance) of each glyph, so measuring only reads this
+	const GFXmetrics* mMetrics; // Optional precomputed metrics. If NULL they are computed when the font is first used
 } GFXfont;
 
 typedef struct {
@@ -124,6 +233,76 @@ typedef struct {
   uint16_t mHeight; 
 } gfx_rect_t;
 
+typedef struct {
+  int mX;
+  int mY;
+} gfx_point_t;
+
+/**
+ * @brief a glyph rasterized into spans. Spans are 3 bytes each (row, x, length) relative to the glyph bitmap
+ */
+typedef struct {
+  const GFXfont* mFont;             //font the glyph belongs to (NULL if the slot is free)
+  uint16_t mGlyph;                  //index of the glyph in the font
+  uint16_t mSpanCount;              //number of spans
+  uint8_t* mSpans;                  //span data
+  uint32_t mLastUse;                //cache clock value when last drawn, for LRU eviction
+  int16_t mNext;                    //next slot in the same hash bucket, -1 for none
+} gfx_glyph_entry_t;
+
+/**
+ * @brief bounded LRU cache of rasterized glyphs
+ */
+typedef struct {
+  gfx_glyph_entry_t mEntries[GFX_GLYPH_CACHE_SLOTS];
+  int16_t mBuckets[GFX_GLYPH_CACHE_SLOTS]; //first slot for each hash bucket, -1 for none
+  uint32_t mBudget;                 //max bytes of span data
+  uint32_t mUsed;                   //bytes of span data held
+  uint32_t mClock;                  //incremented on every lookup
+  uint32_t mHits;                   //lookups found in the cache
+  uint32_t mMisses;                 //lookups that had to rasterize the glyph
+  uint8_t* mBlock;                  //last block decompressed from a GFX_FONT_LZ font, so misses in the same block reuse it
+  uint32_t mBlockSize;              //size of mBlock
+  const GFXfont* mBlockFont;        //font mBlock belongs to, NULL if none
+  uint16_t mBlockIdx;               //index of mBlock in the font's blocks
+  uint32_t mBlockLoads;             //blocks decompressed
+} gfx_glyph_cache_t;
+
+/**
+ * @brief a glyph placed by a text layout
+ */
+typedef struct {
+  const GFXglyph* mGlyph;           //glyph to draw, NULL for GFX_FONT_PACKED fonts (use mIndex)
+  uint16_t mIndex;                  //index of the glyph in the font
+  int16_t mX;                       //cursor x, relative to the layout origin
+  int16_t mY;                       //baseline y, relative to the baseline of the first line
+} gfx_text_item_t;
+
+/**
+ * @brief a line of a text layout
+ */
+typedef struct {
+  uint16_t mFirst;                  //index of the first item in the line
+  uint16_t mCount;                  //number of items in the line
+  int16_t mWidth;                   //width of the line (sum of glyph advances, without the spaces it was wrapped at)
+  bool mWrapped;                    //line was ended by wrapping, not a newline or the end of the text
+} gfx_text_line_t;
+
+/**
+ * @brief a string measured and broken into lines once, so it can be measured, aligned and drawn repeatedly
+ */
+typedef struct {
+  const GFXfont* mFont;             //font the layout was built with
+  gfx_text_item_t* mItems;          //placed glyphs, in string order
+  gfx_text_line_t* mLines;          //lines, in order
+  uint16_t mItemCount;              //number of glyphs
+  uint16_t mLineCount;              //number of lines
+  int16_t mAscent;                  //distance from the baseline to the top of the tallest glyph in the font
+  gfx_rect_t mBounds;               //size of the text box. The same as gfx_get_print_size for unwrapped text
+} gfx_text_layout_t;
+
+typedef mrt_status_t (*f_gfx_write_area)(struct gfx_struct* gfx, gfx_rect_t* area, uint8_t* data, uint32_t stride); //pointer to function that writes one rectangle of the buffer
+
 typedef struct gfx_struct{
   uint8_t* mBuffer;						      //buffer to store pixel data
   int mWidth;						            // width of buffer in pixels
@@ -139,8 +318,34 @@ typedef struct gfx_struct{
   struct{       
       uint32_t mStroke;             //Stroke width for drawing functions
       gfx_color_t mColor;           //Color for drawing functions
+      uint32_t mPacked;             //mColor packed in the canvas byte layout
+      uint8_t mRGBA[4];             //pen color as straight r,g,b,a. If alpha is below 255, drawing blends onto buffered color canvases
+      uint8_t mRop;                 //raster op (gfx_rop_e)
+      uint32_t mBackground;         //background color for GFX_OPT_OPAQUE text, packed in the canvas byte layout
+      uint32_t mRopAnd;             //raster op as pixel = (pixel & mRopAnd) ^ mRopXor, in the canvas byte layout
+      uint32_t mRopXor;
     } mPen;
   uint32_t mFlags;
+  f_gfx_plot fPlot;                 //pixel writer for the color mode, selected at init
+  f_gfx_span fSpan;                 //span writer for the color mode, selected at init
+  int32_t mOrigin;                  //pixel index of (0,0) after flips
+  int32_t mXStep;                   //pixel index step per x
+  int32_t mYStep;                   //pixel index step per y
+  f_gfx_write_area fWriteArea;      //optional function to flush a single dirty region. If NULL, partial refresh uses fWriteBuffer per row
+  gfx_rect_t mDirty[GFX_DIRTY_RECT_COUNT]; //regions of the buffer changed since last refresh (buffer coordinates)
+  uint8_t mDirtyCount;              //number of regions in mDirty
+  uint32_t mDirtyMerge;             //dirty regions are merged when it adds fewer than this many clean pixels
+  uint32_t* mTileHash;              //content hash of each tile as of the last refresh (NULL if tile hashing is disabled)
+  uint8_t* mTileState;              //per tile state flags used during refresh
+  uint16_t mTileSize;               //width and height of hash tiles in pixels
+  uint16_t mTileCols;               //number of tile columns
+  uint16_t mTileRows;               //number of tile rows
+  gfx_rect_t mClip;                 //active clip rect (canvas coordinates). All drawing is limited to this region
+  gfx_rect_t mClipStack[GFX_CLIP_STACK_DEPTH]; //clip rects saved by gfx_push_clip
+  uint8_t mClipDepth;               //number of rects in mClipStack
+  gfx_glyph_cache_t* mGlyphCache;   //rasterized glyphs used by gfx_print (NULL if the cache is disabled)
+  const GFXfont* mMetricsFont;      //font mMetrics was computed for, NULL if none
+  GFXmetrics mMetrics;              //metrics of the last font used that does not store its own
 } gfx_t;
 
 #ifdef __cplusplus
@@ -183,11 +388,58 @@ mrt_status_t gfx_deinit(gfx_t* gfx);
  * @brief Sets pen stroke and color for primitives
  * @param gfx ptr to gfx obj
  * @param stroke pen width
- * @param color pen color
+ * @param color pen color. An 888A/A888 color with alpha below 255 is blended (source-over) onto buffered color canvases
  * @return mrt_status_t 
  */
 mrt_status_t gfx_set_pen(gfx_t* gfx, uint32_t stroke, gfx_color_t color);
 
+/**
+ * @brief Sets how the pen combines with pixels already on the canvas. Raster ops other than GFX_ROP_COPY need to read
+ *        the buffer, so callback canvases always copy. The alpha byte of 888A/A888 pixels is kept by XOR/INVERT/AND/OR
+ * @param gfx ptr to gfx obj
+ * @param rop raster op
+ * @return mrt_status_t 
+ */
+mrt_status_t gfx_set_rop(gfx_t* gfx, gfx_rop_e rop);
+
+/**
+ * @brief Sets the background color used to paint text cells when printing with GFX_OPT_OPAQUE
+ * @param gfx ptr to gfx obj
+ * @param color background color. It is always stored as is (no blending or raster op)
+ * @return mrt_status_t 
+ */
+mrt_status_t gfx_set_background(gfx_t* gfx, gfx_color_t color);
+
+/**
+ * @brief Sets canvas flags (HFLIP/VFLIP). Use this instead of writing mFlags directly so the pixel mapping is updated
+ * @param gfx ptr to gfx obj
+ * @param flags flags to set
+ * @return mrt_status_t 
+ */
+mrt_status_t gfx_set_flags(gfx_t* gfx, uint32_t flags);
+
+/**
+  *@brief converts a color to another color mode. Converting to MONO turns the pixel on if any channel is set
+  *@param color ptr to color to convert (converted in place)
+  *@param target color mode to convert to
+  *@return status of operation
+  */
+mrt_status_t gfx_convert_color(gfx_color_t* color, gfx_color_mode_e target);
+
+/**
+  *@brief converts a run of pixels between color modes. Pixels use the canvas byte layout of their mode: MONO is packed
+  *       8 pixels per byte (MSB first), 565 is 2 bytes big-endian, 888 is r,g,b, 888A is r,g,b,a and A888 is a,r,g,b
+  *@note 888A<->A888 has SSE2/AVX2/NEON kernels and 888<->565 has SSSE3/NEON kernels (define GFX_NO_SIMD to disable).
+  *      Conversions to and from MONO, and all other pairs, are scalar
+  *@param src ptr to source pixels
+  *@param srcMode color mode of source pixels
+  *@param dst ptr to destination pixels. Must not overlap src unless the modes are the same
+  *@param dstMode color mode of destination pixels
+  *@param count number of pixels
+  *@return status of operation
+  */
+mrt_status_t gfx_convert_span(const uint8_t* src, gfx_color_mode_e srcMode, uint8_t* dst, gfx_color_mode_e dstMode, int count);
+
 /**
   *@brief writes a single pixel on the canvas
   *@param gfx ptr to gfx object
@@ -199,24 +451,107 @@ mrt_status_t gfx_set_pen(gfx_t* gfx, uint32_t stroke, gfx_color_t color);
 mrt_status_t gfx_write_pixel(gfx_t* gfx, int x, int y, gfx_color_t* val);
 
 /**
-  *@brief writes an array of bytes to the buffer
+  *@brief writes an array of raw pixel data (in the canvas byte layout) to the buffer. Pixels outside of the clip rect
+  *       are skipped
   *@param gfx ptr to gfx_t descriptor
-  *@param data ptr to black data being written
+  *@param x x coord of first pixel
+  *@param y y coord of first pixel
+  *@param data ptr to data being written
   *@param len number of bytes being written
-  *@param opts option flags
+  *@param wrap if true, data that reaches the right edge continues on the next row at column x. Otherwise it is discarded
   *@return status of operation
   */
-mrt_status_t gfx_write_buffer(gfx_t* gfx, int x, int y, uint8_t* data, int len, uint32_t opt);
+mrt_status_t gfx_write_buffer(gfx_t* gfx, int x, int y, uint8_t* data, int len, bool wrap);
 
 /**
   *@brief writes buffer to device using fWriteBuffer
+  *@note If GFX_FLAG_PARTIAL_REFRESH is set, only the dirty regions are written. Each region goes to fWriteArea if set, otherwise to fWriteBuffer one row at a time.
+  *      Coordinates passed to the callbacks are buffer coordinates (after flips). The dirty regions are cleared before
+  *      the callbacks run, so anything they draw is flushed by the next refresh. If fWriteBuffer is left as
+  *      gfx_write_buffer (no device), refresh only clears the dirty regions
   *@param gfx ptr to gfx_t descriptor
   *@return status of operation
   */
 mrt_status_t gfx_refresh(gfx_t* gfx);
 
 /**
-  *@brief Draws a bitmap to the buffer
+  *@brief marks a region of the canvas as changed so it is included in the next partial refresh. Drawing functions do this automatically
+  *@param gfx ptr to gfx_t descriptor
+  *@param x x coord of region
+  *@param y y coord of region
+  *@param w width of region
+  *@param h height of region
+  *@return status of operation
+  */
+mrt_status_t gfx_mark_dirty(gfx_t* gfx, int x, int y, int w, int h);
+
+/**
+  *@brief clears all dirty regions
+  *@param gfx ptr to gfx_t descriptor
+  *@return status of operation
+  */
+mrt_status_t gfx_clear_dirty(gfx_t* gfx);
+
+/**
+  *@brief sets how eagerly dirty regions are merged. Two regions are merged when the bounding box adds at most this many clean pixels
+  *@param gfx ptr to gfx_t descriptor
+  *@param threshold merge threshold in pixels
+  *@return status of operation
+  */
+mrt_status_t gfx_set_dirty_merge(gfx_t* gfx, uint32_t threshold);
+
+/**
+  *@brief saves the active clip rect and limits drawing to its intersection with a new rect
+  *@param gfx ptr to gfx_t descriptor
+  *@param x x coord of clip rect
+  *@param y y coord of clip rect
+  *@param w width of clip rect
+  *@param h height of clip rect
+  *@return MRT_STATUS_ERROR if the clip stack is full
+  */
+mrt_status_t gfx_push_clip(gfx_t* gfx, int x, int y, int w, int h);
+
+/**
+  *@brief restores the clip rect saved by the last gfx_push_clip
+  *@param gfx ptr to gfx_t descriptor
+  *@return MRT_STATUS_ERROR if the clip stack is empty
+  */
+mrt_status_t gfx_pop_clip(gfx_t* gfx);
+
+/**
+  *@brief enables content hashing of the buffer in square tiles. On refresh, tiles whose contents hash the same as when they were last sent are skipped, even if they were redrawn
+  *@note Hashes are 32 bit, so there is a very small chance (1 in 2^32 per changed tile) of a changed tile being skipped
+  *@param gfx ptr to gfx_t descriptor
+  *@param tileSize width/height of tiles in pixels (rounded up to a multiple of 8 for MONO). 0 disables hashing
+  *@return status of operation
+  */
+mrt_status_t gfx_enable_tile_hash(gfx_t* gfx, int tileSize);
+
+/**
+  *@brief enables a cache of glyphs rasterized into spans for gfx_print. Glyphs are cached per font, and drawn with
+  *       the current pen, so one entry serves every color, color mode and raster op. Least recently used glyphs are
+  *       evicted when the budget or GFX_GLYPH_CACHE_SLOTS is reached. For GFX_FONT_LZ fonts the last decompressed block
+  *       is also kept (outside of the budget), and without the cache every glyph drawn decompresses its block
+  *@param gfx ptr to gfx_t descriptor
+  *@param budget max bytes of span data to hold. 0 disables the cache
+  *@return status of operation
+  */
+mrt_status_t gfx_enable_glyph_cache(gfx_t* gfx, uint32_t budget);
+
+/**
+  *@brief drops everything gfx keeps about a font: its cached glyphs, its decompressed LZ block and its computed
+  *       metrics. These are keyed on the GFXfont address, so call this after changing a GFXfont struct in place or
+  *       filling it with another font (such as gfx_asset_get_font into the same struct after closing a pack)
+  *@param gfx ptr to gfx_t descriptor
+  *@param font font that changed, or NULL for every font
+  *@return status of operation
+  */
+mrt_status_t gfx_font_changed(gfx_t* gfx, const GFXfont* font);
+
+/**
+  *@brief Draws a bitmap to the buffer. MONO bitmaps are drawn with the pen color (clear bits are transparent), color
+  *       bitmaps are copied, and converted to the canvas color mode if needed. 888A/A888 bitmaps (straight alpha) are
+  *       blended onto buffered color canvases
   *@param gfx ptr to gfx_t descriptor
   *@param x x coord to begin drawing at
   *@param y y coord to begin drawing at
@@ -228,23 +563,70 @@ mrt_status_t gfx_draw_bmp(gfx_t* gfx, int x, int y,const GFXBmp* bmp);
 
 /**
  * @brief gets the size of a string based on current font
+ * @note With GFX_OPT_WRAP or an alignment option the size is the box of the layout gfx_print would draw at x = 0
+ *       (mBounds of gfx_text_layout_init), so wrapped text is measured at the canvas width
+ * @note monospace fonts are measured by counting glyphs, without reading glyph metrics
  * @param text 
+ * @param opt print options (GFX_OPT_WRAP, GFX_OPT_ALIGN_x)
  * @return uint32_t 
  */
 gfx_rect_t gfx_get_print_size(gfx_t* gfx, const char* text, uint32_t opt);
 
+/**
+ * @brief gets the metrics of the current font (ascent, descent, advances). Fonts without stored metrics are scanned
+ *        once, and the result is kept until another such font is used (or gfx_font_changed is called)
+ * @param gfx ptr to gfx_t descriptor
+ * @param metrics ptr to store metrics in
+ * @return MRT_STATUS_ERROR if no font is set
+ */
+mrt_status_t gfx_get_font_metrics(gfx_t* gfx, GFXmetrics* metrics);
+
 
 /**
   *@brief Draws rendered text to the buffer
+  *@note With GFX_OPT_WRAP or an alignment option the text is laid out first (see gfx_text_layout_init), wrapped at
+  *      the right edge of the canvas. Text is aligned in the box from x to the right edge of the canvas when wrapping,
+  *      otherwise in a box as wide as the longest line
   *@param gfx ptr to gfx_t descriptor
   *@param x x coord to begin drawing at
   *@param y y coord to begin drawing at
-  *@param text text to be written
-  *@param val pixel value
+  *@param text text to be written, UTF-8 encoded. Bytes that are not part of a valid UTF-8 sequence are read as Latin-1
+  *@param opt print options (GFX_OPT_WRAP, GFX_OPT_OPAQUE, GFX_OPT_ALIGN_x)
   *@return status of operation
   */
 mrt_status_t gfx_print(gfx_t* gfx, int x, int y, const char * text, uint32_t opt);
 
+/**
+  *@brief measures a string and breaks it into lines. The layout can then be drawn any number of times without
+  *       scanning the string again
+  *@param layout ptr to layout to build
+  *@param font font to lay the text out with
+  *@param text text to lay out, UTF-8 encoded (see gfx_print). It is not referenced after this returns
+  *@param wrapWidth lines longer than this (in pixels) are wrapped at the last space, or between characters if a word
+  *       does not fit on a line. Spaces at wrap points are dropped. 0 only breaks lines at newlines
+  *@param align alignment of lines in the text box. The box is wrapWidth wide, or as wide as the longest line if 0
+  *@return MRT_STATUS_ERROR if the text is too long or memory could not be allocated
+  */
+mrt_status_t gfx_text_layout_init(gfx_text_layout_t* layout, const GFXfont* font, const char* text, int wrapWidth, gfx_align_e align);
+
+/**
+  *@brief frees a text layout
+  *@param layout ptr to layout
+  *@return status of operation
+  */
+mrt_status_t gfx_text_layout_deinit(gfx_text_layout_t* layout);
+
+/**
+  *@brief draws a text layout with the current pen. Text is drawn the same as gfx_print
+  *@param gfx ptr to gfx_t descriptor
+  *@param x x coord of the left of the text box
+  *@param y y coord of the baseline of the first line
+  *@param layout layout to draw
+  *@param opt print options (GFX_OPT_OPAQUE)
+  *@return status of operation
+  */
+mrt_status_t gfx_draw_text_layout(gfx_t* gfx, int x, int y, const gfx_text_layout_t* layout, uint32_t opt);
+
 /**
   *@brief draws a rectangle
   *@param gfx ptr to gfx canvas
@@ -269,16 +651,63 @@ mrt_status_t gfx_draw_line(gfx_t* gfx, int x0, int y0, int x1, int y1);
 mrt_status_t gfx_draw_rect(gfx_t* gfx, int x, int y, int w, int h, uint32_t opt);
 
 /**
-  *@brief draws a circle
+  *@brief draws a circle. Outlines use the pen stroke, drawn inward from the radius
   *@param gfx ptr to gfx canvas
 	*@param x x for center point
   *@param y y for center point
-	*@param r radius
+	*@param r radius, at most GFX_MAX_RADIUS
   *@param opt option flags (FILL)
-  *@return "Return of the function"
+  *@return MRT_STATUS_ERROR if the radius is negative or over GFX_MAX_RADIUS
   */
 mrt_status_t gfx_draw_circle(gfx_t* gfx, int x, int y, int r, uint32_t opt);
 
+/**
+  *@brief draws an ellipse. Outlines use the pen stroke, drawn inward from the radii
+  *@param gfx ptr to gfx canvas
+	*@param x x for center point
+  *@param y y for center point
+	*@param rx horizontal radius, at most GFX_MAX_RADIUS
+	*@param ry vertical radius, at most GFX_MAX_RADIUS
+  *@param opt option flags (FILL)
+  *@return MRT_STATUS_ERROR if a radius is negative or over GFX_MAX_RADIUS
+  */
+mrt_status_t gfx_draw_ellipse(gfx_t* gfx, int x, int y, int rx, int ry, uint32_t opt);
+
+/**
+  *@brief draws an arc of a circle. With GFX_OPT_FILL a pie slice is drawn
+  *@param gfx ptr to gfx canvas
+	*@param x x for center point
+  *@param y y for center point
+	*@param r radius, at most GFX_MAX_RADIUS
+	*@param start start angle in degrees, clockwise from 3 o'clock
+	*@param end end angle in degrees, clockwise from 3 o'clock. A sweep of 360 or more draws the full circle
+  *@param opt option flags (FILL)
+  *@return MRT_STATUS_ERROR if the radius is negative or over GFX_MAX_RADIUS
+  */
+mrt_status_t gfx_draw_arc(gfx_t* gfx, int x, int y, int r, int start, int end, uint32_t opt);
+
+/**
+  *@brief draws a closed polygon. Outlines use the pen stroke, and write each pixel once (wide outlines have bevel
+  *       joins). With GFX_OPT_FILL it is filled (see gfx_fill_polygon)
+  *@param gfx ptr to gfx canvas
+  *@param points array of vertices
+  *@param count number of vertices
+  *@param opt option flags (FILL, NONZERO)
+  *@return status of operation
+  */
+mrt_status_t gfx_draw_polygon(gfx_t* gfx, const gfx_point_t* points, int count, uint32_t opt);
+
+/**
+  *@brief fills a polygon with the pen color. Vertices are pixel centers, and a pixel is filled if its center is inside.
+  *       Polygons may be concave or self intersecting. Vertices should be within +/-2^23
+  *@param gfx ptr to gfx canvas
+  *@param points array of vertices
+  *@param count number of vertices
+  *@param opt option flags (NONZERO to use the nonzero winding rule instead of even-odd)
+  *@return status of operation
+  */
+mrt_status_t gfx_fill_polygon(gfx_t* gfx, const gfx_point_t* points, int count, uint32_t opt);
+
 /**
   *@brief fill buffer with pen color
   *@param gfx ptr to gfxice
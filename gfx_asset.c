@@ -0,0 +1,469 @@
+/**
+  *@file gfx_asset.c
+  *@brief binary asset packs of fonts and images
+  *
+  */
+
+
+/* Includes ------------------------------------------------------------------*/
+#include "gfx_asset.h"
+#include "string.h"
+#include <stdlib.h>
+#include <stdio.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define GFX_ASSET_USE_MMAP
+#endif
+
+/* Private Functions ---------------------------------------------------------*/
+
+/**
+ * @brief checks that an array of count entries at offset is inside a block of size bytes, and aligned for its entries
+ */
+static bool gfx_asset_array_valid(uint32_t offset, uint32_t count, uint32_t entrySize, uint32_t align, uint32_t size)
+{
+    return (offset % align == 0) && (offset <= size) && (count <= (size - offset) / entrySize);
+}
+
+/**
+ * @brief gets the offset and pixel count of a glyph of a font in a pack
+ * @return false if the offset is negative
+ */
+static bool gfx_asset_glyph(const gfx_asset_font_t* info, const uint8_t* data, int idx, uint32_t* offset, uint32_t* pixels)
+{
+    if(info->mFlags & GFX_FONT_PACKED)
+    {
+        const GFXpackedGlyph* glyph = &((const GFXpackedGlyph*) (data + info->mGlyph))[idx];
+        *offset = glyph->mOffset;
+        *pixels = glyph->mWidth * glyph->mHeight;
+        return true;
+    }
+
+    const GFXglyph* glyph = &((const GFXglyph*) (data + info->mGlyph))[idx];
+    *offset = (uint32_t)glyph->mOffset;
+    *pixels = glyph->mWidth * glyph->mHeight;
+    return glyph->mOffset >= 0;
+}
+
+/**
+ * @brief checks that the RLE runs of a glyph end inside size bytes of glyph data, reading them the way gfx_print does
+ */
+static bool gfx_asset_rle_valid(const uint8_t* bitmap, uint32_t size, uint32_t offset, uint32_t pixels)
+{
+    uint32_t pos = 0;
+
+    while(pos < pixels)
+    {
+        if(offset >= size)
+        {
+            return false;
+        }
+        pos += bitmap[offset++];
+
+        if(pos < pixels)
+        {
+            if(offset >= size)
+            {
+                return false;
+            }
+            pos += bitmap[offset++];
+        }
+    }
+
+    return true;
+}
+
+/**
+ * @brief checks that the blocks of a GFX_FONT_LZ font are sorted and inside its data, and that every glyph is inside
+ *        the block it is decompressed from. Blocks are not decompressed, so RLE runs are only checked to start inside
+ *        their block (a block that decompresses short is rejected when it is drawn)
+ */
+static bool gfx_asset_lz_valid(const gfx_asset_font_t* info, const uint8_t* data)
+{
+    const GFXblock* blocks = (const GFXblock*) (data + info->mBlocks);
+
+    if((info->mBlocks == 0) || (info->mBlockCount == 0) || (blocks[0].mOffset != 0) || (blocks[0].mStart != 0) ||
+       (blocks[info->mBlockCount].mOffset > info->mBitmapSize))
+    {
+        return false;
+    }
+
+    for(int i=0; i < info->mBlockCount; i++)
+    {
+        if((blocks[i + 1].mOffset < blocks[i].mOffset) || (blocks[i + 1].mStart < blocks[i].mStart))
+        {
+            return false;
+        }
+    }
+
+    for(int i=0; i < info->mGlyphCount; i++)
+    {
+        uint32_t offset, pixels, len;
+        int lo = 0;
+        int hi = info->mBlockCount - 1;
+
+        if(!gfx_asset_glyph(info, data, i, &offset, &pixels))
+        {
+            return false;
+        }
+
+        if(pixels == 0)
+        {
+            continue;
+        }
+
+        //same search as gfx_print: the last block starting at or before the glyph
+        while(lo < hi)
+        {
+            int mid = (lo + hi + 1) / 2;
+
+            if(blocks[mid].mStart <= offset)
+            {
+                lo = mid;
+            }
+            else
+            {
+                hi = mid - 1;
+            }
+        }
+
+        len = (info->mFlags & GFX_FONT_RLE) ? 1 : ((pixels + 7) / 8);
+        if((offset >= blocks[lo + 1].mStart) || (len > blocks[lo + 1].mStart - offset))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * @brief checks that the data of every glyph of a font is inside its bitmap data
+ */
+static bool gfx_asset_glyphs_valid(const gfx_asset_font_t* info, const uint8_t* data)
+{
+    const uint8_t* bitmap = data + info->mBitmap;
+
+    if(info->mFlags & GFX_FONT_LZ)
+    {
+        return gfx_asset_lz_valid(info, data);
+    }
+
+    for(int i=0; i < info->mGlyphCount; i++)
+    {
+        uint32_t offset, pixels;
+
+        if(!gfx_asset_glyph(info, data, i, &offset, &pixels))
+        {
+            return false;
+        }
+
+        if(pixels == 0)
+        {
+            continue;
+        }
+
+        if(info->mFlags & GFX_FONT_RLE)
+        {
+            if(!gfx_asset_rle_valid(bitmap, info->mBitmapSize, offset, pixels))
+            {
+                return false;
+            }
+        }
+        else if((offset > info->mBitmapSize) || ((pixels + 7) / 8 > info->mBitmapSize - offset))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * @brief finds an asset of a given type
+ */
+static const gfx_asset_entry_t* gfx_asset_find_type(const gfx_asset_pack_t* pack, const char* name, gfx_asset_type_e type)
+{
+    const gfx_asset_entry_t* entry = gfx_asset_find(pack, name);
+
+    return ((entry != NULL) && (entry->mType == type)) ? entry : NULL;
+}
+
+/* Exported Functions --------------------------------------------------------*/
+
+mrt_status_t gfx_asset_open(gfx_asset_pack_t* pack, const void* data, uint32_t size)
+{
+    const gfx_asset_header_t* header = (const gfx_asset_header_t*) data;
+
+    memset(pack, 0, sizeof(gfx_asset_pack_t));
+
+    //the pack is used in place, so its structs must be aligned
+    if((data == NULL) || ((uintptr_t)data % 4 != 0) || (size < sizeof(gfx_asset_header_t)))
+    {
+        return MRT_STATUS_ERROR;
+    }
+
+    if((memcmp(header->mMagic, GFX_ASSET_MAGIC, 4) != 0) || (header->mVersion != GFX_ASSET_VERSION) ||
+       (header->mSize > size) || !gfx_asset_array_valid(sizeof(gfx_asset_header_t), header->mCount, sizeof(gfx_asset_entry_t), 4, header->mSize))
+    {
+        return MRT_STATUS_ERROR;
+    }
+
+    pack->mData = (const uint8_t*) data;
+    pack->mSize = header->mSize;
+    pack->mIndex = (const gfx_asset_entry_t*) (pack->mData + sizeof(gfx_asset_header_t));
+    pack->mCount = header->mCount;
+
+    //the index is checked once here, so lookups can trust it
+    for(int i=0; i < pack->mCount; i++)
+    {
+        const gfx_asset_entry_t* entry = &pack->mIndex[i];
+
+        if((memchr(entry->mName, 0, GFX_ASSET_NAME_LEN) == NULL) ||
+           ((i > 0) && (strcmp(pack->mIndex[i - 1].mName, entry->mName) >= 0)) ||
+           !gfx_asset_array_valid(entry->mOffset, entry->mSize, 1, 4, pack->mSize))
+        {
+            memset(pack, 0, sizeof(gfx_asset_pack_t));
+            return MRT_STATUS_ERROR;
+        }
+    }
+
+    return MRT_STATUS_OK;
+}
+
+mrt_status_t gfx_asset_open_file(gfx_asset_pack_t* pack, const char* path)
+{
+    void* mapping;
+    uint32_t size;
+
+#ifdef GFX_ASSET_USE_MMAP
+    struct stat info;
+    int fd = open(path, O_RDONLY);
+
+    memset(pack, 0, sizeof(gfx_asset_pack_t));
+
+    if(fd < 0)
+    {
+        return MRT_STATUS_ERROR;
+    }
+
+    if((fstat(fd, &info) != 0) || (info.st_size <= 0) || ((uint64_t)info.st_size > UINT32_MAX))
+    {
+        close(fd);
+        return MRT_STATUS_ERROR;
+    }
+
+    //pages are only read when an asset is drawn, and are shared with other processes using the same pack
+    size = (uint32_t)info.st_size;
+    mapping = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if(mapping == MAP_FAILED)
+    {
+        return MRT_STATUS_ERROR;
+    }
+
+    if(gfx_asset_open(pack, mapping, size) != MRT_STATUS_OK)
+    {
+        munmap(mapping, size);
+        return MRT_STATUS_ERROR;
+    }
+
+    pack->mMapping = mapping;
+    pack->mMappingSize = size;
+#else
+    FILE* file = fopen(path, "rb");
+    long length;
+
+    memset(pack, 0, sizeof(gfx_asset_pack_t));
+
+    if(file == NULL)
+    {
+        return MRT_STATUS_ERROR;
+    }
+
+    fseek(file, 0, SEEK_END);
+    length = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    mapping = (length > 0) ? malloc(length) : NULL;
+    size = (uint32_t)length;
+
+    if((mapping == NULL) || (fread(mapping, 1, size, file) != size))
+    {
+        free(mapping);
+        fclose(file);
+        return MRT_STATUS_ERROR;
+    }
+
+    fclose(file);
+
+    if(gfx_asset_open(pack, mapping, size) != MRT_STATUS_OK)
+    {
+        free(mapping);
+        return MRT_STATUS_ERROR;
+    }
+
+    pack->mMapping = mapping;
+    pack->mMappingSize = size;
+#endif
+
+    return MRT_STATUS_OK;
+}
+
+mrt_status_t gfx_asset_close(gfx_asset_pack_t* pack)
+{
+    if(pack->mMapping != NULL)
+    {
+#ifdef GFX_ASSET_USE_MMAP
+        munmap(pack->mMapping, pack->mMappingSize);
+#else
+        free(pack->mMapping);
+#endif
+    }
+
+    memset(pack, 0, sizeof(gfx_asset_pack_t));
+
+    return MRT_STATUS_OK;
+}
+
+const gfx_asset_entry_t* gfx_asset_find(const gfx_asset_pack_t* pack, const char* name)
+{
+    int lo = 0;
+    int hi = pack->mCount - 1;
+
+    while(lo <= hi)
+    {
+        int mid = (lo + hi) / 2;
+        int cmp = strcmp(name, pack->mIndex[mid].mName);
+
+        if(cmp < 0)
+        {
+            hi = mid - 1;
+        }
+        else if(cmp > 0)
+        {
+            lo = mid + 1;
+        }
+        else
+        {
+            return &pack->mIndex[mid];
+        }
+    }
+
+    return NULL;
+}
+
+mrt_status_t gfx_asset_get_font(const gfx_asset_pack_t* pack, const char* name, GFXfont* font)
+{
+    const gfx_asset_entry_t* entry = gfx_asset_find_type(pack, name, GFX_ASSET_FONT);
+    const gfx_asset_font_t* info;
+    const uint8_t* data;
+    uint32_t glyphSize;
+
+    if((entry == NULL) || (entry->mSize < sizeof(gfx_asset_font_t)))
+    {
+        return MRT_STATUS_ERROR;
+    }
+
+    data = pack->mData + entry->mOffset;
+    info = (const gfx_asset_font_t*) data;
+    glyphSize = (info->mFlags & GFX_FONT_PACKED) ? sizeof(GFXpackedGlyph) : sizeof(GFXglyph);
+
+    //every array of the font must be inside its data. Optional arrays are at offset 0 when the font does not have them
+    if(!gfx_asset_array_valid(info->mBitmap, info->mBitmapSize, 1, 1, entry->mSize) ||
+       !gfx_asset_array_valid(info->mGlyph, info->mGlyphCount, glyphSize, 4, entry->mSize) ||
+       (info->mRanges && !gfx_asset_array_valid(info->mRanges, info->mRangeCount, sizeof(GFXrange), 4, entry->mSize)) ||
+       (info->mBlocks && !gfx_asset_array_valid(info->mBlocks, info->mBlockCount + 1, sizeof(GFXblock), 4, entry->mSize)) ||
+       (info->mAdvance && !gfx_asset_array_valid(info->mAdvance, info->mGlyphCount, 1, 1, entry->mSize)) ||
+       (info->mMetrics && !gfx_asset_array_valid(info->mMetrics, 1, sizeof(GFXmetrics), 1, entry->mSize)))
+    {
+        return MRT_STATUS_ERROR;
+    }
+
+    //codepoints must map to glyphs the font has
+    if(info->mRanges)
+    {
+        const GFXrange* ranges = (const GFXrange*) (data + info->mRanges);
+
+        for(int i=0; i < info->mRangeCount; i++)
+        {
+            if((uint32_t)ranges[i].mGlyph + ranges[i].mCount > info->mGlyphCount)
+            {
+                return MRT_STATUS_ERROR;
+            }
+        }
+    }
+    else if((info->mLast >= info->mFirst) && (info->mLast - info->mFirst + 1 > info->mGlyphCount))
+    {
+        return MRT_STATUS_ERROR;
+    }
+
+    //and glyphs to data the font has, so a damaged pack can not make gfx_print read outside of it
+    if(!gfx_asset_glyphs_valid(info, data))
+    {
+        return MRT_STATUS_ERROR;
+    }
+
+    memset(font, 0, sizeof(GFXfont));
+    font->mBitmap = (uint8_t*) (data + info->mBitmap);
+    font->mGlyph = (GFXglyph*) (data + info->mGlyph);
+    font->mFirst = info->mFirst;
+    font->mLast = info->mLast;
+    font->mYAdvance = info->mYAdvance;
+    font->mRanges = info->mRanges ? (const GFXrange*) (data + info->mRanges) : NULL;
+    font->mRangeCount = info->mRangeCount;
+    font->mFlags = info->mFlags;
+    font->mBlocks = info->mBlocks ? (const GFXblock*) (data + info->mBlocks) : NULL;
+    font->mBlockCount = info->mBlockCount;
+    font->mAdvance = info->mAdvance ? (data + info->mAdvance) : NULL;
+    font->mMetrics = info->mMetrics ? (const GFXmetrics*) (data + info->mMetrics) : NULL;
+
+    return MRT_STATUS_OK;
+}
+
+mrt_status_t gfx_asset_get_bmp(const gfx_asset_pack_t* pack, const char* name, GFXBmp* bmp)
+{
+    const gfx_asset_entry_t* entry = gfx_asset_find_type(pack, name, GFX_ASSET_BMP);
+    uint32_t bits;
+
+    if(entry == NULL)
+    {
+        return MRT_STATUS_ERROR;
+    }
+
+    switch(entry->mMode)
+    {
+        case GFX_COLOR_MODE_MONO:
+            bits = 1;
+            break;
+        case GFX_COLOR_MODE_565:
+            bits = 16;
+            break;
+        case GFX_COLOR_MODE_888:
+            bits = 24;
+            break;
+        case GFX_COLOR_MODE_888A:
+        case GFX_COLOR_MODE_A888:
+            bits = 32;
+            break;
+        default:
+            return MRT_STATUS_ERROR;
+    }
+
+    if((((uint64_t)entry->mWidth * entry->mHeight * bits) + 7) / 8 > entry->mSize)
+    {
+        return MRT_STATUS_ERROR;
+    }
+
+    bmp->mData = pack->mData + entry->mOffset;
+    bmp->mWidth = entry->mWidth;
+    bmp->mHeight = entry->mHeight;
+    bmp->mMode = (gfx_color_mode_e) entry->mMode;
+
+    return MRT_STATUS_OK;
+}
@@ -0,0 +1,155 @@
+/**
+  *@file gfx_asset.h
+  *@brief binary asset packs of fonts and images, used in place (zero copy) from a mapped file, a flash partition or any
+  *       memory block
+  *
+  *  A pack is a gfx_asset_header_t, followed by an index of gfx_asset_entry_t sorted by name, followed by the data of
+  *  each asset. Every offset is from the start of the pack and 4 byte aligned. Fields are stored in the target byte
+  *  order with natural alignment, the same layout as the structs below (little endian, 32 bit int, as built by
+  *  Tools/assetpack)
+  *
+  *  Image data is the GFXBmp data as is. Font data starts with a gfx_asset_font_t, followed by the arrays of the font
+  *  (bitmaps, glyphs, and the optional ranges, blocks, advances and metrics), so a GFXfont view only needs pointers
+  *  into the pack
+  *
+  */
+#pragma once
+
+/* Includes ------------------------------------------------------------------*/
+#include "gfx.h"
+
+/* Exported macro ------------------------------------------------------------*/
+
+#define GFX_ASSET_MAGIC "GFXA"      //First 4 bytes of a pack
+#define GFX_ASSET_VERSION 1         //Format version written by Tools/assetpack
+#define GFX_ASSET_NAME_LEN 32       //Size of an asset name, including the null terminator
+
+/* Exported types ------------------------------------------------------------*/
+
+typedef enum{
+  GFX_ASSET_FONT = 1,           //GFXfont, data starts with a gfx_asset_font_t
+  GFX_ASSET_BMP = 2             //GFXBmp, data is the bitmap data
+}gfx_asset_type_e;
+
+/**
+ * @brief start of a pack
+ */
+typedef struct {
+  char mMagic[4];               //GFX_ASSET_MAGIC
+  uint16_t mVersion;            //GFX_ASSET_VERSION
+  uint16_t mCount;              //Number of index entries
+  uint32_t mSize;               //Size of the whole pack in bytes
+} gfx_asset_header_t;
+
+/**
+ * @brief index entry of an asset
+ */
+typedef struct {
+  char mName[GFX_ASSET_NAME_LEN]; //Null terminated name, entries are sorted by name (strcmp)
+  uint32_t mOffset;             //Offset of the asset data from the start of the pack
+  uint32_t mSize;               //Size of the asset data
+  uint8_t mType;                //gfx_asset_type_e
+  uint8_t mMode;                //gfx_color_mode_e of images
+  uint16_t mWidth;              //Width of images in pixels, 0 for fonts
+  uint16_t mHeight;             //Height of images in pixels, newline distance of fonts
+  uint16_t mReserved;
+} gfx_asset_entry_t;
+
+/**
+ * @brief header of font data. Offsets are from the start of the font data, 0 for optional arrays the font does not have
+ */
+typedef struct {
+  uint32_t mBitmap;             //GFXfont->mBitmap
+  uint32_t mGlyph;              //GFXfont->mGlyph (GFXpackedGlyph entries with GFX_FONT_PACKED)
+  uint32_t mRanges;             //GFXfont->mRanges
+  uint32_t mBlocks;             //GFXfont->mBlocks
+  uint32_t mAdvance;            //GFXfont->mAdvance
+  uint32_t mMetrics;            //GFXfont->mMetrics
+  uint32_t mBitmapSize;         //Size of the data at mBitmap (compressed size with GFX_FONT_LZ)
+  uint16_t mGlyphCount;         //Number of glyph entries
+  uint16_t mRangeCount;         //GFXfont->mRangeCount
+  uint16_t mBlockCount;         //GFXfont->mBlockCount
+  uint8_t mFirst;               //GFXfont->mFirst
+  uint8_t mLast;                //GFXfont->mLast
+  uint8_t mYAdvance;            //GFXfont->mYAdvance
+  uint8_t mFlags;               //GFXfont->mFlags
+  uint16_t mReserved;
+} gfx_asset_font_t;
+
+/**
+ * @brief an open pack
+ */
+typedef struct {
+  const uint8_t* mData;         //Start of the pack
+  uint32_t mSize;               //Size of the pack
+  const gfx_asset_entry_t* mIndex; //Index entries
+  uint16_t mCount;              //Number of index entries
+  void* mMapping;               //Mapping (or buffer) owned by the pack when opened from a file, NULL otherwise
+  uint32_t mMappingSize;        //Size of mMapping
+} gfx_asset_pack_t;
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* Exported functions ------------------------------------------------------- */
+
+/**
+  *@brief opens a pack that is already in memory, such as a flash partition or an array linked into the firmware. The
+  *       data is used in place and must stay valid until the pack is closed
+  *@param pack ptr to pack descriptor
+  *@param data start of the pack (4 byte aligned)
+  *@param size size of the memory holding the pack
+  *@return MRT_STATUS_ERROR if the data is not a valid pack
+  */
+mrt_status_t gfx_asset_open(gfx_asset_pack_t* pack, const void* data, uint32_t size);
+
+/**
+  *@brief opens a pack file. On Linux (and other POSIX systems) the file is mapped read only, so assets are only paged
+  *       in when they are drawn. Elsewhere the file is read into memory
+  *@param pack ptr to pack descriptor
+  *@param path path of the pack file
+  *@return MRT_STATUS_ERROR if the file can not be opened or is not a valid pack
+  */
+mrt_status_t gfx_asset_open_file(gfx_asset_pack_t* pack, const char* path);
+
+/**
+  *@brief closes a pack, unmapping or freeing the file it was opened from. Font and bitmap views into the pack are no
+  *       longer valid
+  *@param pack ptr to pack descriptor
+  *@return status of operation
+  */
+mrt_status_t gfx_asset_close(gfx_asset_pack_t* pack);
+
+/**
+  *@brief finds an asset by name (binary search of the index)
+  *@param pack ptr to pack descriptor
+  *@param name name of the asset
+  *@return index entry of the asset, or NULL if the pack does not have it
+  */
+const gfx_asset_entry_t* gfx_asset_find(const gfx_asset_pack_t* pack, const char* name);
+
+/**
+  *@brief gets a font from a pack. The font points into the pack, nothing is copied
+  *@note gfx_t caches glyphs and metrics by GFXfont address. When a struct that was already drawn with is filled in
+  *      again (another font, or the same name from a reopened pack), call gfx_font_changed on each gfx_t that used it
+  *@param pack ptr to pack descriptor
+  *@param name name of the font
+  *@param font ptr to font to fill in. It must stay valid while it is the font of a gfx_t
+  *@return MRT_STATUS_ERROR if there is no valid font with this name
+  */
+mrt_status_t gfx_asset_get_font(const gfx_asset_pack_t* pack, const char* name, GFXfont* font);
+
+/**
+  *@brief gets a bitmap from a pack. The bitmap data points into the pack, nothing is copied
+  *@param pack ptr to pack descriptor
+  *@param name name of the bitmap
+  *@param bmp ptr to bitmap to fill in
+  *@return MRT_STATUS_ERROR if there is no valid bitmap with this name
+  */
+mrt_status_t gfx_asset_get_bmp(const gfx_asset_pack_t* pack, const char* name, GFXBmp* bmp);
+
+#ifdef __cplusplus
+}
+#endif